@@ -60,7 +60,7 @@ eventFilter(QObject *object, QEvent *event)
 
     if (event->type() == QEvent::Resize)
     {
-      auto d = std::dynamic_pointer_cast<PixmapData>(_nodeData);
+      auto d = _nodeData.get<PixmapData>();
       if (d)
       {
         _label->setPixmap(d->pixmap().scaled(w, h, Qt::KeepAspectRatio));
@@ -84,7 +84,7 @@ std::shared_ptr<NodeData>
 ImageShowModel::
 outData(PortIndex)
 {
-  return _nodeData;
+  return _nodeData.get();
 }
 
 
@@ -94,9 +94,9 @@ setInData(std::shared_ptr<NodeData> nodeData, PortIndex)
 {
   _nodeData = nodeData;
 
-  if (_nodeData)
+  if (nodeData)
   {
-    auto d = std::dynamic_pointer_cast<PixmapData>(_nodeData);
+    auto d = std::dynamic_pointer_cast<PixmapData>(nodeData);
 
     int w = _label->width();
     int h = _label->height();
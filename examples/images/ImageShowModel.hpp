@@ -7,6 +7,7 @@
 
 #include <nodes/DataModelRegistry>
 #include <nodes/NodeDataModel>
+#include <nodes/RetainedData>
 
 using QtNodes::PortType;
 using QtNodes::PortIndex;
@@ -14,6 +15,7 @@ using QtNodes::NodeData;
 using QtNodes::NodeDataType;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeValidationState;
+using QtNodes::RetainedData;
 
 /// The model dictates the number of inputs and outputs for the Node.
 /// In this example it has no logic.
@@ -74,5 +76,6 @@ private:
 
   QLabel * _label;
 
-  std::shared_ptr<NodeData> _nodeData;
+  /// The label shows a scaled copy, so the full image may be spilled
+  RetainedData _nodeData;
 };
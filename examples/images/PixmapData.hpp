@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QtCore/QDataStream>
 #include <QtGui/QPixmap>
 
 #include <nodes/NodeDataModel>
@@ -29,6 +30,38 @@ public:
   QPixmap
   pixmap() const { return _pixmap; }
 
+  std::size_t
+  byteSize() const override
+  {
+    return std::size_t(_pixmap.width()) * _pixmap.height() * _pixmap.depth() / 8;
+  }
+
+  bool
+  spillPayload(QIODevice &device) override
+  {
+    // implicitly shared copies, e.g. the loader's, keep the pixels alive
+    if (!_pixmap.isDetached())
+      return false;
+
+    QDataStream stream(&device);
+    stream << _pixmap;
+
+    if (stream.status() != QDataStream::Ok)
+      return false;
+
+    _pixmap = QPixmap();
+    return true;
+  }
+
+  bool
+  restorePayload(QIODevice &device) override
+  {
+    QDataStream stream(&device);
+    stream >> _pixmap;
+
+    return stream.status() == QDataStream::Ok;
+  }
+
 private:
 
   QPixmap _pixmap;
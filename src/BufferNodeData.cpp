@@ -0,0 +1,178 @@
+#include "BufferNodeData.hpp"
+
+#include <cstring>
+#include <limits>
+
+#include <QtCore/QIODevice>
+
+using QtNodes::SharedBuffer;
+using QtNodes::BufferNodeData;
+
+namespace
+{
+
+std::shared_ptr<char>
+allocateStorage(std::size_t size)
+{
+  if (size == 0)
+    return std::shared_ptr<char>();
+
+  return std::shared_ptr<char>(new char[size](),
+                               std::default_delete<char[]>());
+}
+}
+
+SharedBuffer::
+SharedBuffer()
+  : _offset(0)
+  , _size(0)
+{}
+
+
+SharedBuffer::
+SharedBuffer(std::size_t size)
+  : _storage(allocateStorage(size))
+  , _offset(0)
+  , _size(size)
+{}
+
+
+SharedBuffer::
+SharedBuffer(void const* data, std::size_t size)
+  : SharedBuffer(size)
+{
+  if (size > 0)
+    std::memcpy(_storage.get(), data, size);
+}
+
+
+SharedBuffer::
+SharedBuffer(QByteArray const &bytes)
+  : SharedBuffer(bytes.constData(), static_cast<std::size_t>(bytes.size()))
+{}
+
+
+bool
+SharedBuffer::
+isShared() const
+{
+  return _storage.use_count() > 1;
+}
+
+
+char const*
+SharedBuffer::
+constData() const
+{
+  return _storage ? _storage.get() + _offset : nullptr;
+}
+
+
+char*
+SharedBuffer::
+data()
+{
+  detach();
+
+  return _storage ? _storage.get() + _offset : nullptr;
+}
+
+
+void
+SharedBuffer::
+detach()
+{
+  if (!isShared())
+    return;
+
+  // copy only the visible range, a detached slice does not
+  // keep the whole parent allocation alive
+  auto storage = allocateStorage(_size);
+
+  std::memcpy(storage.get(), constData(), _size);
+
+  _storage = std::move(storage);
+  _offset  = 0;
+}
+
+
+SharedBuffer
+SharedBuffer::
+slice(std::size_t offset, std::size_t length) const
+{
+  offset = std::min(offset, _size);
+  length = std::min(length, _size - offset);
+
+  SharedBuffer result;
+
+  if (length > 0)
+  {
+    result._storage = _storage;
+    result._offset  = _offset + offset;
+    result._size    = length;
+  }
+
+  return result;
+}
+
+
+QByteArray
+SharedBuffer::
+toByteArray(bool* ok) const
+{
+  bool const fits = _size <= static_cast<std::size_t>(std::numeric_limits<int>::max());
+
+  if (ok)
+    *ok = fits;
+
+  if (!fits)
+  {
+    Q_ASSERT_X(ok, "SharedBuffer::toByteArray", "buffer exceeds INT_MAX bytes");
+    return QByteArray();
+  }
+
+  return QByteArray(constData(), static_cast<int>(_size));
+}
+
+//------------------------------------------------------------------------------
+
+bool
+BufferNodeData::
+spillPayload(QIODevice &device)
+{
+  // slices and copies elsewhere keep the memory alive anyway
+  if (_buffer.isShared())
+    return false;
+
+  quint64 const size = _buffer.size();
+
+  if (device.write(reinterpret_cast<char const*>(&size), sizeof(size)) != sizeof(size))
+    return false;
+
+  if (size > 0 && device.write(_buffer.constData(), size) != qint64(size))
+    return false;
+
+  _buffer = SharedBuffer();
+
+  return true;
+}
+
+
+bool
+BufferNodeData::
+restorePayload(QIODevice &device)
+{
+  quint64 size = 0;
+
+  if (device.read(reinterpret_cast<char*>(&size), sizeof(size)) != sizeof(size))
+    return false;
+
+  SharedBuffer buffer(static_cast<std::size_t>(size));
+
+  if (size > 0 && device.read(buffer.data(), size) != qint64(size))
+    return false;
+
+  _buffer = std::move(buffer);
+
+  return true;
+}
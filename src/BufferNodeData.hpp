@@ -0,0 +1,211 @@
+#pragma once
+
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtGlobal>
+
+#include "NodeData.hpp"
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Read-only typed window into a SharedBuffer.
+/// The view does not own memory, keep the buffer alive while using it.
+template<typename T>
+class BufferView
+{
+public:
+
+  BufferView()
+    : _data(nullptr)
+    , _size(0)
+  {}
+
+  BufferView(T const* data, std::size_t size)
+    : _data(data)
+    , _size(size)
+  {}
+
+public:
+
+  T const*
+  data() const { return _data; }
+
+  std::size_t
+  size() const { return _size; }
+
+  bool
+  empty() const { return _size == 0; }
+
+  T const*
+  begin() const { return _data; }
+
+  T const*
+  end() const { return _data + _size; }
+
+  T const&
+  operator[](std::size_t i) const
+  {
+    Q_ASSERT(i < _size);
+    return _data[i];
+  }
+
+  /// Elements [first, first + count), clamped to the view
+  BufferView
+  subView(std::size_t first, std::size_t count) const
+  {
+    first = std::min(first, _size);
+    count = std::min(count, _size - first);
+
+    return BufferView(_data + first, count);
+  }
+
+private:
+
+  T const*    _data;
+  std::size_t _size;
+};
+
+
+/// Reference-counted byte storage.
+/// Copies and slices share the same memory, so forwarding a buffer
+/// through a chain of nodes never copies the payload.
+/// Writing through `data()` detaches the buffer first (copy-on-write).
+class NODE_EDITOR_PUBLIC SharedBuffer
+{
+public:
+
+  SharedBuffer();
+
+  /// Allocates `size` zero-initialized bytes
+  explicit
+  SharedBuffer(std::size_t size);
+
+  SharedBuffer(void const* data, std::size_t size);
+
+  explicit
+  SharedBuffer(QByteArray const &bytes);
+
+public:
+
+  std::size_t
+  size() const { return _size; }
+
+  bool
+  isEmpty() const { return _size == 0; }
+
+  /// True if the memory is referenced by another buffer or slice
+  bool
+  isShared() const;
+
+  char const*
+  constData() const;
+
+  /// Detaches if shared and returns writable memory
+  char*
+  data();
+
+  /// Makes sure this buffer is the only owner of its bytes
+  void
+  detach();
+
+  /// Bytes [offset, offset + length), clamped to the buffer.
+  /// The result shares memory with this buffer.
+  SharedBuffer
+  slice(std::size_t offset, std::size_t length) const;
+
+  /// Deep copy of the contents. A QByteArray holds at most INT_MAX
+  /// bytes, just under 2 GiB; larger buffers give an empty array and
+  /// set `*ok` to false. Without `ok` that is asserted in debug builds.
+  QByteArray
+  toByteArray(bool* ok = nullptr) const;
+
+public:
+
+  template<typename T>
+  BufferView<T>
+  view() const
+  {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "BufferView requires a trivially copyable type");
+
+    Q_ASSERT(reinterpret_cast<quintptr>(constData()) % alignof(T) == 0);
+
+    return BufferView<T>(reinterpret_cast<T const*>(constData()),
+                         _size / sizeof(T));
+  }
+
+  /// Elements [first, first + count) of type T, sharing memory
+  template<typename T>
+  SharedBuffer
+  sliceElements(std::size_t first, std::size_t count) const
+  {
+    return slice(first * sizeof(T), count * sizeof(T));
+  }
+
+  template<typename T>
+  T*
+  mutableData()
+  {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "SharedBuffer requires a trivially copyable type");
+
+    return reinterpret_cast<T*>(data());
+  }
+
+private:
+
+  std::shared_ptr<char> _storage;
+
+  std::size_t _offset;
+  std::size_t _size;
+};
+
+
+/// Base class for NodeData carrying a large immutable payload.
+/// Subclasses provide `type()` and construct from a SharedBuffer,
+/// so pass-through and slicing models can forward data without copying:
+///
+///   auto in = std::dynamic_pointer_cast<FloatArrayData>(data);
+///   _out = std::make_shared<FloatArrayData>(in->buffer().slice(a, n));
+class NODE_EDITOR_PUBLIC BufferNodeData : public NodeData
+{
+public:
+
+  SharedBuffer const &
+  buffer() const { return _buffer; }
+
+  std::size_t
+  byteSize() const override { return _buffer.size(); }
+
+  template<typename T>
+  BufferView<T>
+  view() const { return _buffer.view<T>(); }
+
+  /// Spills the bytes unless they are shared with another buffer
+  bool
+  spillPayload(QIODevice &device) override;
+
+  bool
+  restorePayload(QIODevice &device) override;
+
+protected:
+
+  BufferNodeData() = default;
+
+  explicit
+  BufferNodeData(SharedBuffer buffer)
+    : _buffer(std::move(buffer))
+  {}
+
+private:
+
+  SharedBuffer _buffer;
+};
+}
@@ -1,6 +1,5 @@
 #include "Connection.hpp"
 
-#include <iostream>
 #include <math.h>
 
 #include <QtWidgets/QtWidgets>
@@ -17,6 +16,8 @@
 #include "ConnectionState.hpp"
 #include "ConnectionGeometry.hpp"
 #include "ConnectionGraphicsObject.hpp"
+#include "Logging.hpp"
+#include "Trace.hpp"
 
 using QtNodes::Connection;
 using QtNodes::PortType;
@@ -25,8 +26,10 @@ using QtNodes::ConnectionState;
 using QtNodes::Node;
 using QtNodes::NodeData;
 using QtNodes::NodeDataType;
+using QtNodes::TypeId;
 using QtNodes::ConnectionGraphicsObject;
 using QtNodes::ConnectionGeometry;
+using QtNodes::lifetimeLog;
 
 Connection::
 Connection(PortType portType,
@@ -65,17 +68,17 @@ Connection::
 {
   propagateEmptyData();
 
-  if (_inNode)
+  if (_inNode && !_inNode->group())
   {
     _inNode->nodeGraphicsObject().update();
   }
 
-  if (_outNode)
+  if (_outNode && !_outNode->group())
   {
     _outNode->nodeGraphicsObject().update();
   }
 
-  std::cout << "Connection destructor" << std::endl;
+  NODE_EDITOR_DEBUG(lifetimeLog) << "Connection destructor" << _id;
 }
 
 
@@ -144,6 +147,10 @@ setGraphicsObject(std::unique_ptr<ConnectionGraphicsObject>&& graphics)
 {
   _connectionGraphicsObject = std::move(graphics);
 
+  // released while the connection is inside a collapsed group
+  if (!_connectionGraphicsObject)
+    return;
+
   // This function is only called when the ConnectionGraphicsObject
   // is newly created. At this moment both end coordinates are (0, 0)
   // in Connection G.O. coordinates. The position of the whole
@@ -160,12 +167,7 @@ setGraphicsObject(std::unique_ptr<ConnectionGraphicsObject>&& graphics)
 
     auto node = getNode(attachedPort);
 
-    QTransform nodeSceneTransform =
-      node->nodeGraphicsObject().sceneTransform();
-
-    QPointF pos = node->nodeGeometry().portScenePosition(attachedPortIndex,
-                                                         attachedPort,
-                                                         nodeSceneTransform);
+    QPointF pos = node->portScenePosition(attachedPort, attachedPortIndex);
 
     _connectionGraphicsObject->setPos(pos);
   }
@@ -174,6 +176,15 @@ setGraphicsObject(std::unique_ptr<ConnectionGraphicsObject>&& graphics)
 }
 
 
+bool
+Connection::
+isCollapsed() const
+{
+  return _inNode && _outNode &&
+         _inNode->group() && _inNode->group() == _outNode->group();
+}
+
+
 PortIndex
 Connection::
 getPortIndex(PortType portType) const
@@ -232,6 +243,17 @@ removeFromNodes() const
 }
 
 
+void
+Connection::
+setPortIndex(PortType portType, PortIndex portIndex)
+{
+  if (portType == PortType::Out)
+    _outPortIndex = portIndex;
+  else
+    _inPortIndex = portIndex;
+}
+
+
 ConnectionGraphicsObject&
 Connection::
 getConnectionGraphicsObject() const
@@ -350,19 +372,33 @@ dataType() const
 
   if (validNode)
   {
-    auto const &model = validNode->nodeDataModel();
-
-    return model->dataType(portType, index);
+    return validNode->portTable().port(portType, index).dataType;
   }
 
   Q_UNREACHABLE();
 }
 
 
+TypeId
+Connection::
+typeId() const
+{
+  if (_inNode)
+    return _inNode->portTable().port(PortType::In, _inPortIndex).typeId;
+
+  if (_outNode)
+    return _outNode->portTable().port(PortType::Out, _outPortIndex).typeId;
+
+  return INVALID_TYPE_ID;
+}
+
+
 void
 Connection::
 propagateData(std::shared_ptr<NodeData> nodeData) const
 {
+  NODE_EDITOR_TRACE_SCOPE("propagation", "Connection::propagateData");
+
   if (_inNode)
   {
     _inNode->propagateData(nodeData, _inPortIndex);
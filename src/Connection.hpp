@@ -8,6 +8,7 @@
 
 #include "PortType.hpp"
 #include "NodeData.hpp"
+#include "NodeDataTypeRegistry.hpp"
 
 #include "Serializable.hpp"
 #include "ConnectionState.hpp"
@@ -95,6 +96,11 @@ public:
   void
   removeFromNodes() const;
 
+  /// Re-targets an attached end after ports were inserted
+  /// into or removed from its node
+  void
+  setPortIndex(PortType portType, PortIndex portIndex);
+
 public:
 
   ConnectionGraphicsObject&
@@ -120,12 +126,21 @@ public:
   PortIndex
   getPortIndex(PortType portType) const;
 
+  /// True while both ends are collapsed into the same group node;
+  /// such a connection has no graphics object
+  bool
+  isCollapsed() const;
+
   void
   clearNode(PortType portType);
 
   NodeDataType
   dataType() const;
 
+  /// Interned id of `dataType()`
+  TypeId
+  typeId() const;
+
 public: // data propagation
 
   void
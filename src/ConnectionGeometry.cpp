@@ -14,6 +14,7 @@ ConnectionGeometry()
   //, _animationPhase(0)
   , _lineWidth(3.0)
   , _hovered(false)
+  , _segmentBoundsValid(false)
 { }
 
 QPointF const&
@@ -45,6 +46,8 @@ setEndPoint(PortType portType, QPointF const& point)
     default:
       break;
   }
+
+  _segmentBoundsValid = false;
 }
 
 
@@ -65,6 +68,8 @@ moveEndPoint(PortType portType, QPointF const &offset)
     default:
       break;
   }
+
+  _segmentBoundsValid = false;
 }
 
 
@@ -72,19 +77,18 @@ QRectF
 ConnectionGeometry::
 boundingRect() const
 {
-  auto points = pointsC1C2();
-
-  QRectF basicRect = QRectF(_out, _in).normalized();
+  // the curve itself rather than the hull of all control points,
+  // which is far larger for long wires
+  QRectF commonRect;
 
-  QRectF c1c2Rect = QRectF(points.first, points.second).normalized();
+  for (QRectF const &r : segmentBounds())
+    commonRect |= r;
 
   auto const &connectionStyle =
     StyleCollection::connectionStyle();
 
   float const diam = connectionStyle.pointDiameter();
 
-  QRectF commonRect = basicRect.united(c1c2Rect);
-
   QPointF const cornerOffset(diam, diam);
 
   commonRect.setTopLeft(commonRect.topLeft() - cornerOffset);
@@ -130,3 +134,71 @@ pointsC1C2() const
 
   return std::make_pair(c1, c2);
 }
+
+
+unsigned int
+ConnectionGeometry::
+curveSegments()
+{
+  return 32;
+}
+
+
+std::vector<QRectF> const &
+ConnectionGeometry::
+segmentBounds() const
+{
+  if (_segmentBoundsValid)
+    return _segmentBounds;
+
+  unsigned int const n = curveSegments();
+
+  _segmentBounds.resize(n);
+
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    auto const p = subCurve(double(i) / n, double(i + 1) / n);
+
+    _segmentBounds[i] = QRectF(p[0], p[3]).normalized() |
+                        QRectF(p[1], p[2]).normalized();
+  }
+
+  _segmentBoundsValid = true;
+
+  return _segmentBounds;
+}
+
+
+std::array<QPointF, 4>
+ConnectionGeometry::
+subCurve(double t0, double t1) const
+{
+  auto const c1c2 = pointsC1C2();
+
+  std::array<QPointF, 4> p{{ _out, c1c2.first, c1c2.second, _in }};
+
+  // de Casteljau split, keeps either the head or the tail of `p`
+  auto split =
+    [](std::array<QPointF, 4> const &c, double t, bool head)
+    {
+      QPointF const p01  = c[0] + (c[1] - c[0]) * t;
+      QPointF const p12  = c[1] + (c[2] - c[1]) * t;
+      QPointF const p23  = c[2] + (c[3] - c[2]) * t;
+      QPointF const p012 = p01 + (p12 - p01) * t;
+      QPointF const p123 = p12 + (p23 - p12) * t;
+      QPointF const mid  = p012 + (p123 - p012) * t;
+
+      if (head)
+        return std::array<QPointF, 4>{{ c[0], p01, p012, mid }};
+
+      return std::array<QPointF, 4>{{ mid, p123, p23, c[3] }};
+    };
+
+  if (t1 < 1.0)
+    p = split(p, t1, true);
+
+  if (t0 > 0.0 && t1 > 0.0)
+    p = split(p, t0 / t1, false);
+
+  return p;
+}
@@ -5,6 +5,8 @@
 #include <QtCore/QPointF>
 #include <QtCore/QRectF>
 
+#include <array>
+#include <vector>
 #include <iostream>
 
 namespace QtNodes
@@ -33,6 +35,21 @@ public:
   std::pair<QPointF, QPointF>
   pointsC1C2() const;
 
+  /// Number of equal parameter steps used by `segmentBounds`
+  static
+  unsigned int
+  curveSegments();
+
+  /// Bounding boxes of the curve pieces between parameter steps.
+  /// Each box holds the control polygon of its piece, so it contains
+  /// the curve exactly. Cached until an end point moves.
+  std::vector<QRectF> const &
+  segmentBounds() const;
+
+  /// Control points of the part of the spline between t0 and t1
+  std::array<QPointF, 4>
+  subCurve(double t0, double t1) const;
+
   QPointF
   source() const { return _out; }
   QPointF
@@ -56,5 +73,8 @@ private:
   double _lineWidth;
 
   bool _hovered;
+
+  mutable std::vector<QRectF> _segmentBounds;
+  mutable bool                _segmentBoundsValid;
 };
 }
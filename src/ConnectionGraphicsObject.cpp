@@ -19,10 +19,12 @@
 #include "NodeConnectionInteraction.hpp"
 
 #include "Node.hpp"
+#include "Logging.hpp"
 
 using QtNodes::ConnectionGraphicsObject;
 using QtNodes::Connection;
 using QtNodes::FlowScene;
+using QtNodes::lifetimeLog;
 
 ConnectionGraphicsObject::
 ConnectionGraphicsObject(FlowScene &scene,
@@ -30,12 +32,13 @@ ConnectionGraphicsObject(FlowScene &scene,
   : _scene(scene)
   , _connection(connection)
 {
-  _scene.addItem(this);
-
   setFlag(QGraphicsItem::ItemIsMovable, true);
   setFlag(QGraphicsItem::ItemIsFocusable, true);
   setFlag(QGraphicsItem::ItemIsSelectable, true);
 
+  // needed for an exact exposedRect in paint()
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+
   setAcceptHoverEvents(true);
 
   // addGraphicsEffect();
@@ -47,7 +50,7 @@ ConnectionGraphicsObject(FlowScene &scene,
 ConnectionGraphicsObject::
 ~ConnectionGraphicsObject()
 {
-  std::cout << "Remove ConnectionGraphicsObject from scene" << std::endl;
+  NODE_EDITOR_DEBUG(lifetimeLog) << "Remove ConnectionGraphicsObject from scene";
 
   _scene.removeItem(this);
 }
@@ -108,14 +111,10 @@ move()
   {
     if (auto node = _connection.getNode(portType))
     {
-      auto const &nodeGraphics = node->nodeGraphicsObject();
-
-      auto const &nodeGeom = node->nodeGeometry();
-
+      // on the group node's port if the node is collapsed
       QPointF scenePos =
-        nodeGeom.portScenePosition(_connection.getPortIndex(portType),
-                                   portType,
-                                   nodeGraphics.sceneTransform());
+        node->portScenePosition(portType,
+                                _connection.getPortIndex(portType));
 
       {
         QTransform sceneTransform = this->sceneTransform();
@@ -152,7 +151,8 @@ paint(QPainter* painter,
   painter->setClipRect(option->exposedRect);
 
   ConnectionPainter::paint(painter,
-                           _connection);
+                           _connection,
+                           option->exposedRect);
 }
 
 
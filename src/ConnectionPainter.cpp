@@ -10,10 +10,13 @@
 #include "NodeData.hpp"
 
 #include "StyleCollection.hpp"
+#include "RenderStatistics.hpp"
+#include "Trace.hpp"
 
 using QtNodes::ConnectionPainter;
 using QtNodes::ConnectionGeometry;
 using QtNodes::Connection;
+using QtNodes::RenderCounters;
 
 ConnectionPainter::
 ConnectionPainter()
@@ -37,6 +40,46 @@ cubicPath(ConnectionGeometry const& geom)
 }
 
 
+QPainterPath
+ConnectionPainter::
+cubicPath(ConnectionGeometry const& geom,
+          QRectF const& rect,
+          double margin)
+{
+  auto const &bounds = geom.segmentBounds();
+
+  QRectF const area = rect.adjusted(-margin, -margin, margin, margin);
+
+  double const n = bounds.size();
+
+  QPainterPath result;
+
+  // every run of visible segments becomes one exact piece of the spline
+  std::size_t i = 0;
+
+  while (i < bounds.size())
+  {
+    if (!bounds[i].intersects(area))
+    {
+      ++i;
+      continue;
+    }
+
+    std::size_t const first = i;
+
+    while (i < bounds.size() && bounds[i].intersects(area))
+      ++i;
+
+    auto const p = geom.subCurve(first / n, i / n);
+
+    result.moveTo(p[0]);
+    result.cubicTo(p[1], p[2], p[3]);
+  }
+
+  return result;
+}
+
+
 QPainterPath
 ConnectionPainter::
 getPainterStroke(ConnectionGeometry const& geom)
@@ -61,40 +104,53 @@ getPainterStroke(ConnectionGeometry const& geom)
 
 
 #include <limits>
+#include <algorithm>
 
 #include <QDebug>
 
 void
 ConnectionPainter::
 paint(QPainter* painter,
-      Connection const &connection)
+      Connection const &connection,
+      QRectF const& exposedRect)
 {
+  NODE_EDITOR_TRACE_SCOPE("paint", "ConnectionPainter::paint");
+
   auto const &connectionStyle =
     StyleCollection::connectionStyle();
 
+  ConnectionGeometry const& geom =
+    connection.connectionGeometry();
+
+  double const lineWidth     = connectionStyle.lineWidth();
+  double const pointDiameter = connectionStyle.pointDiameter();
+
+  // wide enough for the hover halo and the end points
+  double const margin = std::max(lineWidth, pointDiameter / 2.0) + 1.0;
+
+  auto cubic = exposedRect.isNull()
+               ? cubicPath(geom)
+               : cubicPath(geom, exposedRect, margin);
+
+  if (cubic.isEmpty())
+    return;
+
+  ++RenderCounters::totals().paintedConnections;
+
   QColor normalColor   = connectionStyle.normalColor();
   QColor hoverColor    = connectionStyle.hoveredColor();
   QColor selectedColor = connectionStyle.selectedColor();
 
-  auto dataType = connection.dataType();
-
   if (connectionStyle.useDataDefinedColors())
   {
-
-    normalColor   = connectionStyle.normalColor(dataType.id);
+    normalColor   = connectionStyle.normalColor(connection.typeId());
     hoverColor    = normalColor.lighter(200);
     selectedColor = normalColor.darker(200);
   }
 
-  ConnectionGeometry const& geom =
-    connection.connectionGeometry();
-
   ConnectionState const& state =
     connection.connectionState();
 
-  double const lineWidth     = connectionStyle.lineWidth();
-  double const pointDiameter = connectionStyle.pointDiameter();
-
 #ifdef DEBUG_DRAWING
 
   {
@@ -124,8 +180,6 @@ paint(QPainter* painter,
   }
 #endif
 
-  auto cubic = cubicPath(geom);
-
   bool const hovered = geom.hovered();
 
   auto const& graphicsObject =
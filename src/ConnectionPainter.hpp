@@ -23,13 +23,24 @@ public:
   QPainterPath
   cubicPath(ConnectionGeometry const& geom);
 
+  /// Only the parts of the cubic whose segment bounds come within
+  /// `margin` of `rect`. Empty if the curve misses the rect.
+  static
+  QPainterPath
+  cubicPath(ConnectionGeometry const& geom,
+            QRectF const& rect,
+            double margin);
+
   static
   QPainterPath
   getPainterStroke(ConnectionGeometry const& geom);
 
+  /// Paints the part of the connection inside `exposedRect`,
+  /// a null rect paints everything
   static
   void
   paint(QPainter* painter,
-        Connection const& connection);
+        Connection const& connection,
+        QRectF const& exposedRect = QRectF());
 };
 }
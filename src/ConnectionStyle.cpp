@@ -13,6 +13,8 @@
 #include "StyleCollection.hpp"
 
 using QtNodes::ConnectionStyle;
+using QtNodes::NodeDataTypeRegistry;
+using QtNodes::TypeId;
 
 inline void initResources() { Q_INIT_RESOURCE(resources); }
 
@@ -173,6 +175,22 @@ normalColor(QString typeId) const
 }
 
 
+QColor
+ConnectionStyle::
+normalColor(TypeId typeId) const
+{
+  if (typeId >= _typeColors.size())
+    _typeColors.resize(typeId + 1);
+
+  QColor &color = _typeColors[typeId];
+
+  if (!color.isValid())
+    color = normalColor(NodeDataTypeRegistry::typeIdString(typeId));
+
+  return color;
+}
+
+
 QColor
 ConnectionStyle::
 selectedColor() const
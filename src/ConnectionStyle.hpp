@@ -1,9 +1,12 @@
 #pragma once
 
+#include <vector>
+
 #include <QtGui/QColor>
 
 #include "Export.hpp"
 #include "Style.hpp"
+#include "NodeDataTypeRegistry.hpp"
 
 namespace QtNodes
 {
@@ -33,6 +36,8 @@ public:
   QColor constructionColor() const;
   QColor normalColor() const;
   QColor normalColor(QString typeId) const;
+  /// Same color as normalColor(QString), cached per interned type
+  QColor normalColor(TypeId typeId) const;
   QColor selectedColor() const;
   QColor selectedHaloColor() const;
   QColor hoveredColor() const;
@@ -56,5 +61,7 @@ private:
   float PointDiameter;
 
   bool UseDataDefinedColors;
+
+  mutable std::vector<QColor> _typeColors;
 };
 }
@@ -5,6 +5,8 @@
 
 using QtNodes::DataModelRegistry;
 using QtNodes::NodeDataModel;
+using QtNodes::NodeDataTypeRegistry;
+using QtNodes::TypeId;
 
 std::unique_ptr<NodeDataModel>
 DataModelRegistry::
@@ -49,7 +51,16 @@ std::unique_ptr<NodeDataModel>
 DataModelRegistry::
 getTypeConverter(QString const &sourceTypeID, QString const &destTypeID) const
 {
-  auto typeConverterKey = std::make_pair(sourceTypeID, destTypeID);
+  return getTypeConverter(NodeDataTypeRegistry::intern(sourceTypeID),
+                          NodeDataTypeRegistry::intern(destTypeID));
+}
+
+
+std::unique_ptr<NodeDataModel>
+DataModelRegistry::
+getTypeConverter(TypeId sourceTypeId, TypeId destTypeId) const
+{
+  auto typeConverterKey = std::make_pair(sourceTypeId, destTypeId);
   auto converter = _registeredTypeConverters.find(typeConverterKey);
 
   if (converter != _registeredTypeConverters.end())
@@ -57,4 +68,14 @@ getTypeConverter(QString const &sourceTypeID, QString const &destTypeID) const
     return converter->second->Model->clone();
   }
   return nullptr;
-}
\ No newline at end of file
+}
+
+
+bool
+DataModelRegistry::
+hasTypeConverter(TypeId sourceTypeId, TypeId destTypeId) const
+{
+  auto typeConverterKey = std::make_pair(sourceTypeId, destTypeId);
+
+  return _registeredTypeConverters.count(typeConverterKey) != 0;
+}
@@ -7,6 +7,7 @@
 #include <QtCore/QString>
 
 #include "NodeDataModel.hpp"
+#include "NodeDataTypeRegistry.hpp"
 #include "Export.hpp"
 #include "QStringStdHash.hpp"
 
@@ -31,9 +32,9 @@ public:
     NodeDataType    DestinationType{};
   };
 
-  using ConvertingTypesPair = std::pair<QString, QString>; //Source type ID, Destination type ID in this order
+  using ConvertingTypesPair = std::pair<TypeId, TypeId>; //Source type ID, Destination type ID in this order
   using TypeConverterItemPtr = std::unique_ptr<TypeConverterItem>;
-  using RegisteredTypeConvertersMap = std::map<ConvertingTypesPair, TypeConverterItemPtr>;
+  using RegisteredTypeConvertersMap = std::unordered_map<ConvertingTypesPair, TypeConverterItemPtr, TypeIdPairHash>;
 
   DataModelRegistry()  = default;
   ~DataModelRegistry() = default;
@@ -81,7 +82,8 @@ public:
       converter->SourceType = converter->Model->dataType(PortType::In, 0);
       converter->DestinationType = converter->Model->dataType(PortType::Out, 0);
 
-      auto typeConverterKey = std::make_pair(converter->SourceType.id, converter->DestinationType.id);
+      auto typeConverterKey = std::make_pair(NodeDataTypeRegistry::intern(converter->SourceType.id),
+                                             NodeDataTypeRegistry::intern(converter->DestinationType.id));
 	  _registeredTypeConverters[typeConverterKey] = std::move(converter);
     }
   }
@@ -110,6 +112,15 @@ public:
   getTypeConverter(QString const &sourceTypeID,
                    QString const &destTypeID) const;
 
+  std::unique_ptr<NodeDataModel>
+  getTypeConverter(TypeId sourceTypeId,
+                   TypeId destTypeId) const;
+
+  /// Same lookup as getTypeConverter without cloning the converter model
+  bool
+  hasTypeConverter(TypeId sourceTypeId,
+                   TypeId destTypeId) const;
+
 private:
 
   RegisteredModelsCategoryMap _registeredModelsCategory{};
@@ -0,0 +1,643 @@
+#include "FlowMinimap.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QtGui/QMouseEvent>
+#include <QtGui/QPainter>
+#include <QtWidgets/QScrollBar>
+
+#include "FlowScene.hpp"
+#include "FlowView.hpp"
+#include "Node.hpp"
+#include "NodeGeometry.hpp"
+#include "NodeState.hpp"
+#include "NodeGraphicsObject.hpp"
+#include "NodeGroupModel.hpp"
+#include "Connection.hpp"
+#include "StyleCollection.hpp"
+
+using QtNodes::FlowMinimap;
+using QtNodes::FlowScene;
+using QtNodes::FlowView;
+using QtNodes::Node;
+using QtNodes::NodeGroupModel;
+using QtNodes::Connection;
+using QtNodes::PortType;
+
+namespace
+{
+
+/// Raster pixels per side of a bucket
+int const cellSize = 16;
+
+/// Moves `item` from the cells in `from` to the cells in `to`
+template<typename T>
+void
+moveInCells(std::vector<std::unordered_set<T const*> > &cells,
+            int columns,
+            T const* item,
+            QRect const& from,
+            QRect const& to)
+{
+  if (from == to)
+    return;
+
+  for (int y = from.top(); y <= from.bottom(); ++y)
+  {
+    for (int x = from.left(); x <= from.right(); ++x)
+      cells[y * columns + x].erase(item);
+  }
+
+  for (int y = to.top(); y <= to.bottom(); ++y)
+  {
+    for (int x = to.left(); x <= to.right(); ++x)
+      cells[y * columns + x].insert(item);
+  }
+}
+}
+
+FlowMinimap::
+FlowMinimap(FlowScene* scene, FlowView* view, QWidget* parent)
+  : QWidget(parent)
+  , _scene(scene)
+  , _view(view)
+  , _cellColumns(0)
+  , _cellRows(0)
+  , _resolution(256, 256)
+  , _needsRebuild(true)
+{
+  for (auto const &entry : _scene->nodes())
+  {
+    Node const &node = *entry.second;
+
+    if (!node.group())
+      _nodes[&node] = nodeRect(node, node.nodeGraphicsObject().pos());
+  }
+
+  for (auto const &entry : _scene->connections())
+    onConnectionCreated(*entry.second);
+
+  connect(_scene, &FlowScene::nodeCreated,        this, &FlowMinimap::onNodeCreated);
+  connect(_scene, &FlowScene::nodesCreated,       this, &FlowMinimap::onNodesCreated);
+  connect(_scene, &FlowScene::nodeDeleted,        this, &FlowMinimap::onNodeDeleted);
+  connect(_scene, &FlowScene::nodeMoved,          this, &FlowMinimap::onNodeMoved);
+  connect(_scene, &FlowScene::nodesMoved,         this, &FlowMinimap::onNodesMoved);
+  connect(_scene, &FlowScene::connectionCreated,  this, &FlowMinimap::onConnectionCreated);
+  connect(_scene, &FlowScene::connectionsCreated, this, &FlowMinimap::onConnectionsCreated);
+  connect(_scene, &FlowScene::connectionDeleted,  this, &FlowMinimap::onConnectionDeleted);
+  connect(_scene, &FlowScene::nodesCollapsed,     this, &FlowMinimap::onNodesCollapsed);
+  connect(_scene, &FlowScene::nodesExpanded,      this, &FlowMinimap::onNodesExpanded);
+
+  // the view rectangle follows scrolling and zooming
+  auto onViewChanged = [this] { update(); };
+
+  for (QScrollBar* bar : { _view->horizontalScrollBar(), _view->verticalScrollBar() })
+  {
+    connect(bar, &QScrollBar::valueChanged, this, onViewChanged);
+    connect(bar, &QScrollBar::rangeChanged, this, onViewChanged);
+  }
+}
+
+
+void
+FlowMinimap::
+setResolution(QSize const& resolution)
+{
+  _resolution  = resolution.expandedTo(QSize(16, 16));
+  _needsRebuild = true;
+
+  update();
+}
+
+
+QSize
+FlowMinimap::
+sizeHint() const
+{
+  return QSize(200, 150);
+}
+
+
+void
+FlowMinimap::
+paintEvent(QPaintEvent* event)
+{
+  Q_UNUSED(event);
+
+  flush();
+
+  QPainter painter(this);
+
+  painter.fillRect(rect(), StyleCollection::flowViewStyle().BackgroundColor);
+
+  if (_image.isNull())
+    return;
+
+  painter.setTransform(imageToWidget());
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  painter.drawImage(QPointF(0.0, 0.0), _image);
+
+  QRectF const visible =
+    _view->mapToScene(_view->viewport()->rect()).boundingRect();
+
+  painter.setTransform(sceneToImage() * imageToWidget());
+
+  QColor const frame = StyleCollection::nodeStyle().SelectedBoundaryColor;
+
+  QColor fill = frame;
+  fill.setAlpha(40);
+
+  painter.setPen(QPen(frame, 0.0));
+  painter.setBrush(fill);
+  painter.drawRect(visible);
+}
+
+
+void
+FlowMinimap::
+mousePressEvent(QMouseEvent* event)
+{
+  if (event->button() == Qt::LeftButton)
+    centerView(event->pos());
+}
+
+
+void
+FlowMinimap::
+mouseMoveEvent(QMouseEvent* event)
+{
+  if (event->buttons() & Qt::LeftButton)
+    centerView(event->pos());
+}
+
+
+void
+FlowMinimap::
+onNodeCreated(Node& node)
+{
+  setNodeRect(node, nodeRect(node, node.nodeGraphicsObject().pos()));
+}
+
+
+void
+FlowMinimap::
+onNodesCreated(std::vector<Node*> const& nodes)
+{
+  for (Node* node : nodes)
+    onNodeCreated(*node);
+}
+
+
+void
+FlowMinimap::
+onNodeDeleted(Node& node)
+{
+  removeNode(node);
+}
+
+
+void
+FlowMinimap::
+onNodeMoved(Node& node, QPointF const& newLocation)
+{
+  if (_nodes.find(&node) == _nodes.end())
+    return;
+
+  setNodeRect(node, nodeRect(node, newLocation));
+
+  updateConnections(node);
+}
+
+
+void
+FlowMinimap::
+onNodesMoved(std::vector<Node*> const& nodes, QPointF const& offset)
+{
+  Q_UNUSED(offset);
+
+  for (Node* node : nodes)
+    onNodeMoved(*node, node->position());
+}
+
+
+void
+FlowMinimap::
+onNodesCollapsed(Node& group, std::vector<Node*> const& nodes)
+{
+  for (Node* node : nodes)
+    removeNode(*node);
+
+  updateConnections(group);
+}
+
+
+void
+FlowMinimap::
+onNodesExpanded(std::vector<Node*> const& nodes)
+{
+  for (Node* node : nodes)
+    onNodeCreated(*node);
+
+  for (Node* node : nodes)
+    updateConnections(*node);
+}
+
+
+void
+FlowMinimap::
+onConnectionCreated(Connection& connection)
+{
+  // a connection dragged from a port gets its second node later
+  connect(&connection, &Connection::updated,
+          this, &FlowMinimap::onConnectionUpdated);
+
+  setConnectionRect(connection, QRectF());
+
+  updateConnection(connection);
+}
+
+
+void
+FlowMinimap::
+onConnectionsCreated(std::vector<Connection*> const& connections)
+{
+  for (Connection* connection : connections)
+    onConnectionCreated(*connection);
+}
+
+
+void
+FlowMinimap::
+onConnectionDeleted(Connection& connection)
+{
+  if (_connections.find(&connection) == _connections.end())
+    return;
+
+  disconnect(&connection, nullptr, this, nullptr);
+
+  removeConnection(connection);
+}
+
+
+void
+FlowMinimap::
+onConnectionUpdated(Connection& connection)
+{
+  updateConnection(connection);
+}
+
+
+QRectF
+FlowMinimap::
+nodeRect(Node const& node, QPointF const& position) const
+{
+  NodeGeometry const &geom = node.nodeGeometry();
+
+  return QRectF(position, QSizeF(geom.width(), geom.height()));
+}
+
+
+void
+FlowMinimap::
+setNodeRect(Node const& node, QRectF const& rect)
+{
+  QRectF &stored = _nodes[&node];
+
+  QRect const from = cellRange(stored);
+
+  invalidate(stored);
+
+  stored = rect;
+
+  invalidate(stored);
+
+  moveInCells(_nodeCells, _cellColumns, &node, from, cellRange(stored));
+}
+
+
+void
+FlowMinimap::
+removeNode(Node const& node)
+{
+  auto it = _nodes.find(&node);
+
+  if (it == _nodes.end())
+    return;
+
+  moveInCells(_nodeCells, _cellColumns, &node, cellRange(it->second), QRect());
+
+  invalidate(it->second);
+
+  _nodes.erase(it);
+}
+
+
+void
+FlowMinimap::
+setConnectionRect(Connection const& connection, QRectF const& rect)
+{
+  QRectF &stored = _connections[&connection];
+
+  QRect const from = cellRange(stored);
+
+  invalidate(stored);
+
+  stored = rect;
+
+  invalidate(stored);
+
+  moveInCells(_connectionCells, _cellColumns, &connection, from, cellRange(stored));
+}
+
+
+void
+FlowMinimap::
+removeConnection(Connection const& connection)
+{
+  auto it = _connections.find(&connection);
+
+  if (it == _connections.end())
+    return;
+
+  moveInCells(_connectionCells, _cellColumns, &connection,
+              cellRange(it->second), QRect());
+
+  invalidate(it->second);
+
+  _connections.erase(it);
+}
+
+
+QRect
+FlowMinimap::
+cellRange(QRectF const& sceneRect) const
+{
+  if (sceneRect.isNull() || _needsRebuild)
+    return QRect();
+
+  // the same pixels invalidate() marks dirty
+  return cellRange(sceneToImage().mapRect(sceneRect).toAlignedRect().adjusted(-1, -1, 1, 1));
+}
+
+
+QRect
+FlowMinimap::
+cellRange(QRect const& imageRect) const
+{
+  QRect const cells(QPoint(std::max(0, imageRect.left()) / cellSize,
+                           std::max(0, imageRect.top())  / cellSize),
+                    QPoint(std::min(_cellColumns - 1, imageRect.right()  / cellSize),
+                           std::min(_cellRows - 1,    imageRect.bottom() / cellSize)));
+
+  if (imageRect.isEmpty() || !cells.isValid())
+    return QRect();
+
+  return cells;
+}
+
+
+QLineF
+FlowMinimap::
+connectionLine(Connection const& connection) const
+{
+  // collapsed nodes are drawn as their group
+  auto visible =
+    [this](Node const* node)
+    {
+      return _nodes.find((node && node->group()) ? node->group() : node);
+    };
+
+  auto out = visible(connection.getNode(PortType::Out));
+  auto in  = visible(connection.getNode(PortType::In));
+
+  if (out == _nodes.end() || in == _nodes.end() || out == in)
+    return QLineF();
+
+  QRectF const &outRect = out->second;
+  QRectF const &inRect  = in->second;
+
+  return QLineF(QPointF(outRect.right(), outRect.center().y()),
+                QPointF(inRect.left(),   inRect.center().y()));
+}
+
+
+void
+FlowMinimap::
+updateConnection(Connection const& connection)
+{
+  if (_connections.find(&connection) == _connections.end())
+    return;
+
+  QLineF const line = connectionLine(connection);
+
+  setConnectionRect(connection,
+                    line.isNull()
+                    ? QRectF()
+                    : QRectF(line.p1(), line.p2()).normalized());
+}
+
+
+void
+FlowMinimap::
+updateConnections(Node const& node)
+{
+  for (PortType portType : { PortType::In, PortType::Out })
+  {
+    for (auto const &connections : node.nodeState().getEntries(portType))
+    {
+      for (auto const &pair : connections)
+        updateConnection(*pair.second);
+    }
+  }
+
+  if (auto group = dynamic_cast<NodeGroupModel const*>(node.nodeDataModel()))
+  {
+    for (Connection const* connection : group->boundaryConnections())
+      updateConnection(*connection);
+  }
+}
+
+
+void
+FlowMinimap::
+invalidate(QRectF const& sceneRect)
+{
+  if (sceneRect.isNull() || _needsRebuild)
+    return;
+
+  // growing past the raster requires a new fit
+  if (!_world.contains(sceneRect))
+  {
+    _needsRebuild = true;
+  }
+  else
+  {
+    // one pixel more for antialiasing and the line width
+    _dirty |= sceneToImage().mapRect(sceneRect).toAlignedRect().adjusted(-1, -1, 1, 1);
+  }
+
+  update();
+}
+
+
+void
+FlowMinimap::
+rebuild()
+{
+  _needsRebuild = false;
+
+  _nodeCells.clear();
+  _connectionCells.clear();
+
+  _cellColumns = 0;
+  _cellRows    = 0;
+
+  QRectF bounds;
+
+  for (auto const &entry : _nodes)
+    bounds |= entry.second;
+
+  if (bounds.isEmpty())
+  {
+    _world = QRectF();
+    _image = QImage();
+    _dirty = QRect();
+    return;
+  }
+
+  // leave room around the graph so that moving nodes
+  // rarely forces another rebuild
+  double const margin = 0.25 * std::max(bounds.width(), bounds.height());
+
+  bounds.adjust(-margin, -margin, margin, margin);
+
+  double const scale = std::min(_resolution.width()  / bounds.width(),
+                                _resolution.height() / bounds.height());
+
+  QSize const size(std::max(1, int(std::floor(bounds.width()  * scale))),
+                   std::max(1, int(std::floor(bounds.height() * scale))));
+
+  // the world rect has the aspect ratio of the raster
+  _world = QRectF(bounds.topLeft(), QSizeF(size) / scale);
+
+  if (_image.size() != size)
+    _image = QImage(size, QImage::Format_RGB32);
+
+  _dirty = _image.rect();
+
+  _cellColumns = (size.width()  + cellSize - 1) / cellSize;
+  _cellRows    = (size.height() + cellSize - 1) / cellSize;
+
+  _nodeCells.resize(_cellColumns * _cellRows);
+  _connectionCells.resize(_cellColumns * _cellRows);
+
+  for (auto const &entry : _nodes)
+    moveInCells(_nodeCells, _cellColumns, entry.first, QRect(), cellRange(entry.second));
+
+  for (auto const &entry : _connections)
+    moveInCells(_connectionCells, _cellColumns, entry.first, QRect(), cellRange(entry.second));
+}
+
+
+void
+FlowMinimap::
+flush()
+{
+  if (_needsRebuild)
+    rebuild();
+
+  if (_dirty.isEmpty() || _image.isNull())
+    return;
+
+  _dirty &= _image.rect();
+
+  QTransform const transform = sceneToImage();
+
+  // only items bucketed in the dirty cells can draw into it
+  QRect const cells = cellRange(_dirty);
+
+  std::unordered_set<Connection const*> connections;
+  std::unordered_set<Node const*>       nodes;
+
+  for (int y = cells.top(); y <= cells.bottom(); ++y)
+  {
+    for (int x = cells.left(); x <= cells.right(); ++x)
+    {
+      auto const &c = _connectionCells[y * _cellColumns + x];
+      auto const &n = _nodeCells[y * _cellColumns + x];
+
+      connections.insert(c.begin(), c.end());
+      nodes.insert(n.begin(), n.end());
+    }
+  }
+
+  QPainter painter(&_image);
+
+  painter.setClipRect(_dirty);
+  painter.fillRect(_dirty, StyleCollection::flowViewStyle().BackgroundColor);
+
+  painter.setTransform(transform);
+
+  painter.setPen(QPen(StyleCollection::connectionStyle().normalColor(), 0.0));
+
+  // the clip rect drops what falls outside the dirty area
+  for (Connection const* connection : connections)
+    painter.drawLine(connectionLine(*connection));
+
+  QColor const nodeColor = StyleCollection::nodeStyle().GradientColor1;
+
+  for (Node const* node : nodes)
+    painter.fillRect(_nodes.at(node), nodeColor);
+
+  _dirty = QRect();
+}
+
+
+QTransform
+FlowMinimap::
+sceneToImage() const
+{
+  if (_world.isEmpty())
+    return QTransform();
+
+  double const scale = _image.width() / _world.width();
+
+  QTransform t;
+  t.scale(scale, scale);
+  t.translate(-_world.left(), -_world.top());
+
+  return t;
+}
+
+
+QTransform
+FlowMinimap::
+imageToWidget() const
+{
+  if (_image.isNull())
+    return QTransform();
+
+  double const scale = std::min(double(width())  / _image.width(),
+                                double(height()) / _image.height());
+
+  QTransform t;
+  t.translate((width()  - _image.width()  * scale) / 2.0,
+              (height() - _image.height() * scale) / 2.0);
+  t.scale(scale, scale);
+
+  return t;
+}
+
+
+void
+FlowMinimap::
+centerView(QPoint const& widgetPosition)
+{
+  if (_image.isNull())
+    return;
+
+  QTransform const widgetToScene = (sceneToImage() * imageToWidget()).inverted();
+
+  _view->centerOn(widgetToScene.map(QPointF(widgetPosition)));
+}
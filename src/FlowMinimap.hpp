@@ -0,0 +1,188 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtGui/QImage>
+#include <QtWidgets/QWidget>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class FlowScene;
+class FlowView;
+class Node;
+class Connection;
+
+/// Overview of the whole scene that navigates a FlowView.
+///
+/// The widget keeps a low resolution raster of nodes and connections.
+/// Scene signals only mark the changed area dirty; dirty areas are
+/// redrawn from cached rectangles on the next paint, the scene itself
+/// is never rendered. The rectangles are bucketed by raster cell, so
+/// a redraw visits only the items near the dirty area. The raster
+/// never exceeds `resolution()`.
+class NODE_EDITOR_PUBLIC FlowMinimap
+  : public QWidget
+{
+  Q_OBJECT
+
+public:
+
+  FlowMinimap(FlowScene* scene, FlowView* view, QWidget* parent = nullptr);
+
+  FlowMinimap(const FlowMinimap&) = delete;
+  FlowMinimap operator=(const FlowMinimap&) = delete;
+
+public:
+
+  /// Maximum size of the raster, bounds the memory used
+  QSize
+  resolution() const { return _resolution; }
+
+  void
+  setResolution(QSize const& resolution);
+
+  QSize
+  sizeHint() const override;
+
+protected:
+
+  void
+  paintEvent(QPaintEvent* event) override;
+
+  void
+  mousePressEvent(QMouseEvent* event) override;
+
+  void
+  mouseMoveEvent(QMouseEvent* event) override;
+
+private slots:
+
+  void
+  onNodeCreated(Node& node);
+
+  void
+  onNodesCreated(std::vector<Node*> const& nodes);
+
+  void
+  onNodeDeleted(Node& node);
+
+  void
+  onNodeMoved(Node& node, QPointF const& newLocation);
+
+  void
+  onNodesMoved(std::vector<Node*> const& nodes, QPointF const& offset);
+
+  void
+  onNodesCollapsed(Node& group, std::vector<Node*> const& nodes);
+
+  void
+  onNodesExpanded(std::vector<Node*> const& nodes);
+
+  void
+  onConnectionCreated(Connection& connection);
+
+  void
+  onConnectionsCreated(std::vector<Connection*> const& connections);
+
+  void
+  onConnectionDeleted(Connection& connection);
+
+  void
+  onConnectionUpdated(Connection& connection);
+
+private:
+
+  QRectF
+  nodeRect(Node const& node, QPointF const& position) const;
+
+  /// Stores the bounds of `node`, repaints and re-buckets it
+  void
+  setNodeRect(Node const& node, QRectF const& rect);
+
+  void
+  removeNode(Node const& node);
+
+  void
+  setConnectionRect(Connection const& connection, QRectF const& rect);
+
+  void
+  removeConnection(Connection const& connection);
+
+  /// Cells drawn into by a scene area, empty while
+  /// the raster needs a rebuild
+  QRect
+  cellRange(QRectF const& sceneRect) const;
+
+  /// Cells covering a raster area
+  QRect
+  cellRange(QRect const& imageRect) const;
+
+  /// Straight line between the connected nodes, null if incomplete
+  QLineF
+  connectionLine(Connection const& connection) const;
+
+  /// Recomputes the cached bounds of `connection` and repaints
+  /// both the old and the new area
+  void
+  updateConnection(Connection const& connection);
+
+  /// updateConnection() for every connection drawn at `node`
+  void
+  updateConnections(Node const& node);
+
+  /// Marks a scene area for redrawing
+  void
+  invalidate(QRectF const& sceneRect);
+
+  /// Fits the raster to the scene and redraws everything
+  void
+  rebuild();
+
+  /// Redraws the dirty part of the raster
+  void
+  flush();
+
+  QTransform
+  sceneToImage() const;
+
+  /// Transform from the raster to the widget
+  QTransform
+  imageToWidget() const;
+
+  void
+  centerView(QPoint const& widgetPosition);
+
+private:
+
+  FlowScene* _scene;
+  FlowView*  _view;
+
+  std::unordered_map<Node const*, QRectF>       _nodes;
+  std::unordered_map<Connection const*, QRectF> _connections;
+
+  /// Items drawn into each raster cell, row by row
+  std::vector<std::unordered_set<Node const*> >       _nodeCells;
+  std::vector<std::unordered_set<Connection const*> > _connectionCells;
+
+  int _cellColumns;
+  int _cellRows;
+
+  QSize  _resolution;
+  QImage _image;
+
+  /// Scene area covered by the raster
+  QRectF _world;
+
+  /// Dirty part of the raster in image coordinates
+  QRect _dirty;
+
+  bool _needsRebuild;
+};
+}
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <unordered_set>
 
 #include <QtWidgets/QGraphicsSceneMoveEvent>
 #include <QtWidgets/QFileDialog>
@@ -9,6 +11,9 @@
 #include <QtCore/QBuffer>
 #include <QtCore/QDataStream>
 #include <QtCore/QFile>
+#include <QtCore/QEvent>
+#include <QtCore/QTimer>
+#include <QtGui/QPixmapCache>
 
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
@@ -25,6 +30,9 @@
 #include "FlowItemInterface.hpp"
 #include "FlowView.hpp"
 #include "DataModelRegistry.hpp"
+#include "NodeGroupModel.hpp"
+#include "RetainedData.hpp"
+#include "Trace.hpp"
 
 using QtNodes::FlowScene;
 using QtNodes::Node;
@@ -32,13 +40,22 @@ using QtNodes::NodeGraphicsObject;
 using QtNodes::Connection;
 using QtNodes::DataModelRegistry;
 using QtNodes::NodeDataModel;
+using QtNodes::NodeGroupModel;
 //using QtNodes::Properties;
 using QtNodes::PortType;
 using QtNodes::PortIndex;
+using QtNodes::NodeData;
+using QtNodes::NodeMemoryUsage;
+using QtNodes::DataRetention;
 
 FlowScene::
 FlowScene(std::shared_ptr<DataModelRegistry> registry)
   : _registry(registry)
+  , _movingNodes(false)
+  , _profilingEnabled(false)
+  , _profilingHeatmapVisible(false)
+  , _memoryBudget(0)
+  , _memoryCheckPending(false)
 {
   setItemIndexMethod(QGraphicsScene::NoIndex);
 }
@@ -59,10 +76,14 @@ createConnection(PortType connectedPort,
                  Node& node,
                  PortIndex portIndex)
 {
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::createConnection");
+
   auto connection = std::make_shared<Connection>(connectedPort, node, portIndex);
 
   auto cgo = std::make_unique<ConnectionGraphicsObject>(*this, *connection);
 
+  addItem(cgo.get());
+
   // after this function connection points are set to node port
   connection->setGraphicsObject(std::move(cgo));
 
@@ -80,6 +101,8 @@ createConnection(Node& nodeIn,
                  Node& nodeOut,
                  PortIndex portIndexOut)
 {
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::createConnection");
+
 
   auto connection =
     std::make_shared<Connection>(nodeIn,
@@ -89,6 +112,8 @@ createConnection(Node& nodeIn,
 
   auto cgo = std::make_unique<ConnectionGraphicsObject>(*this, *connection);
 
+  addItem(cgo.get());
+
   nodeIn.nodeState().setConnection(PortType::In, portIndexIn, *connection);
   nodeOut.nodeState().setConnection(PortType::Out, portIndexOut, *connection);
 
@@ -126,10 +151,151 @@ restoreConnection(QJsonObject const &connectionJson)
 }
 
 
+std::vector<std::shared_ptr<Connection> >
+FlowScene::
+createConnections(std::vector<ConnectionDescription> const& descriptions)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::createConnections");
+
+  std::vector<std::shared_ptr<Connection> > result;
+  result.reserve(descriptions.size());
+
+  _connections.reserve(_connections.size() + descriptions.size());
+
+  for (auto const &d : descriptions)
+  {
+    auto connection =
+      std::make_shared<Connection>(*d.nodeIn,
+                                   d.portIndexIn,
+                                   *d.nodeOut,
+                                   d.portIndexOut);
+
+    d.nodeIn->nodeState().setConnection(PortType::In, d.portIndexIn, *connection);
+    d.nodeOut->nodeState().setConnection(PortType::Out, d.portIndexOut, *connection);
+
+    // inside a collapsed group, expandGroup() creates the item
+    if (!connection->isCollapsed())
+    {
+      connection->setGraphicsObject(
+        std::make_unique<ConnectionGraphicsObject>(*this, *connection));
+    }
+
+    _connections[connection->id()] = connection;
+
+    result.push_back(std::move(connection));
+  }
+
+  std::vector<Connection*> created;
+  created.reserve(result.size());
+
+  for (auto const &connection : result)
+  {
+    if (!connection->isCollapsed())
+      addItem(&connection->getConnectionGraphicsObject());
+
+    created.push_back(connection.get());
+  }
+
+  // Propagation runs through the new connections synchronously, so
+  // only nodes not fed by the batch start it: the sources, and one
+  // node of every cycle the sources do not reach.
+  std::unordered_map<Node*, std::vector<PortIndex> > outPorts;
+  std::unordered_map<Node*, unsigned int>            inDegree;
+  std::unordered_map<Node*, std::vector<Node*> >     downstream;
+
+  for (auto const &d : descriptions)
+  {
+    auto &ports = outPorts[d.nodeOut];
+
+    if (std::find(ports.begin(), ports.end(), d.portIndexOut) == ports.end())
+      ports.push_back(d.portIndexOut);
+
+    inDegree[d.nodeOut];
+    ++inDegree[d.nodeIn];
+
+    downstream[d.nodeOut].push_back(d.nodeIn);
+  }
+
+  std::unordered_set<Node*> reached;
+  std::vector<Node*>        pending;
+
+  // batch out-ports that have pushed their data, either as a start
+  // point or because their model re-emitted when propagation reached it
+  std::unordered_map<Node*, std::unordered_set<PortIndex> > pushed;
+  std::vector<QMetaObject::Connection>                    watches;
+
+  for (auto const &pair : outPorts)
+  {
+    Node* node = pair.first;
+
+    watches.push_back(
+      connect(node->nodeDataModel(), &NodeDataModel::dataUpdated, this,
+              [&pushed, node](PortIndex index) { pushed[node].insert(index); }));
+  }
+
+  auto propagateFrom =
+    [&](Node* node)
+    {
+      for (PortIndex portIndex : outPorts[node])
+      {
+        pushed[node].insert(portIndex);
+        node->onDataUpdated(portIndex);
+      }
+
+      pending.push_back(node);
+      reached.insert(node);
+
+      while (!pending.empty())
+      {
+        Node* current = pending.back();
+        pending.pop_back();
+
+        for (Node* next : downstream[current])
+        {
+          if (reached.insert(next).second)
+            pending.push_back(next);
+        }
+      }
+    };
+
+  for (auto const &pair : inDegree)
+  {
+    if (pair.second == 0)
+      propagateFrom(pair.first);
+  }
+
+  for (auto const &pair : inDegree)
+  {
+    if (!reached.count(pair.first))
+      propagateFrom(pair.first);
+  }
+
+  // a model that does not re-emit from setInData() has not fed its new
+  // connections yet; push its current output once
+  for (auto const &pair : outPorts)
+  {
+    for (PortIndex portIndex : pair.second)
+    {
+      if (pushed[pair.first].insert(portIndex).second)
+        pair.first->onDataUpdated(portIndex);
+    }
+  }
+
+  for (auto const &watch : watches)
+    disconnect(watch);
+
+  connectionsCreated(created);
+
+  return result;
+}
+
+
 void
 FlowScene::
 deleteConnection(Connection& connection)
 {
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::deleteConnection");
+
   connectionDeleted(connection);
   connection.removeFromNodes();
   _connections.erase(connection.id());
@@ -140,11 +306,19 @@ Node&
 FlowScene::
 createNode(std::unique_ptr<NodeDataModel> && dataModel)
 {
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::createNode");
+
   auto node = std::make_unique<Node>(std::move(dataModel));
   auto ngo  = std::make_unique<NodeGraphicsObject>(*this, *node);
 
+  addItem(ngo.get());
+
   node->setGraphicsObject(std::move(ngo));
 
+  connectNodeSignals(*node);
+
+  node->setProfilingEnabled(_profilingEnabled);
+
   auto nodePtr = node.get();
   _nodes[node->id()] = std::move(node);
 
@@ -153,10 +327,51 @@ createNode(std::unique_ptr<NodeDataModel> && dataModel)
 }
 
 
+std::vector<Node*>
+FlowScene::
+createNodes(std::vector<NodeDescription> && descriptions)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::createNodes");
+
+  std::vector<Node*> result;
+  result.reserve(descriptions.size());
+
+  _nodes.reserve(_nodes.size() + descriptions.size());
+
+  for (auto &d : descriptions)
+  {
+    auto node = std::make_unique<Node>(std::move(d.model));
+    auto ngo  = std::make_unique<NodeGraphicsObject>(*this, *node);
+
+    node->setGraphicsObject(std::move(ngo));
+
+    // not in the scene yet, so this does not signal a move
+    node->nodeGraphicsObject().setPos(d.position);
+
+    connectNodeSignals(*node);
+
+    node->setProfilingEnabled(_profilingEnabled);
+
+    result.push_back(node.get());
+
+    _nodes[node->id()] = std::move(node);
+  }
+
+  for (Node* node : result)
+    addItem(&node->nodeGraphicsObject());
+
+  nodesCreated(result);
+
+  return result;
+}
+
+
 Node&
 FlowScene::
 restoreNode(QJsonObject const& nodeJson)
 {
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::restoreNode");
+
   QString modelName = nodeJson["model"].toObject()["name"].toString();
 
   auto dataModel = registry().create(modelName);
@@ -167,10 +382,15 @@ restoreNode(QJsonObject const& nodeJson)
 
   auto node = std::make_unique<Node>(std::move(dataModel));
   auto ngo  = std::make_unique<NodeGraphicsObject>(*this, *node);
+  addItem(ngo.get());
   node->setGraphicsObject(std::move(ngo));
 
   node->restore(nodeJson);
 
+  connectNodeSignals(*node);
+
+  node->setProfilingEnabled(_profilingEnabled);
+
   auto nodePtr = node.get();
   _nodes[node->id()] = std::move(node);
 
@@ -183,26 +403,149 @@ void
 FlowScene::
 removeNode(Node& node)
 {
-  // call signal
-  nodeDeleted(node);
+  removeNodes({ &node });
+}
 
-  auto deleteConnections =
-    [&node, this] (PortType portType)
-    {
-      auto nodeState = node.nodeState();
-      auto const & nodeEntries = nodeState.getEntries(portType);
 
-      for (auto &connections : nodeEntries)
+void
+FlowScene::
+removeNodes(std::vector<Node*> const& nodes)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::removeNodes");
+
+  std::unordered_set<Node*> doomed(nodes.begin(), nodes.end());
+
+  // a removed group takes its nodes along
+  for (Node* node : nodes)
+  {
+    if (auto group = dynamic_cast<NodeGroupModel*>(node->nodeDataModel()))
+      doomed.insert(group->nodes().begin(), group->nodes().end());
+  }
+
+  // a single removed inner node would leave the group's ports stale
+  for (Node* node : nodes)
+  {
+    if (node->group() && !doomed.count(node->group()))
+      expandGroup(*node->group());
+  }
+
+  // collect first, the node states change while connections go away
+  std::unordered_set<Connection*> connections;
+
+  for (Node* node : doomed)
+  {
+    // call signal
+    nodeDeleted(*node);
+
+    for (PortType portType : { PortType::In, PortType::Out })
+    {
+      for (auto const &entries : node->nodeState().getEntries(portType))
       {
-        for (auto const &pair : connections)
-          deleteConnection(*pair.second);
+        for (auto const &pair : entries)
+          connections.insert(pair.second);
       }
-    };
+    }
+  }
 
-  deleteConnections(PortType::In);
-  deleteConnections(PortType::Out);
+  for (Connection* connection : connections)
+  {
+    connectionDeleted(*connection);
 
-  _nodes.erase(node.id());
+    connection->removeFromNodes();
+
+    // without a node on the doomed end the destructor neither
+    // propagates into it nor repaints it
+    for (PortType portType : { PortType::In, PortType::Out })
+    {
+      if (doomed.count(connection->getNode(portType)))
+        connection->clearNode(portType);
+    }
+
+    _connections.erase(connection->id());
+  }
+
+  for (Node* node : doomed)
+    _nodes.erase(node->id());
+}
+
+
+bool
+FlowScene::
+event(QEvent* event)
+{
+  if (event->type() == QEvent::FontChange)
+  {
+    for (auto const & pair : _nodes)
+    {
+      Node & node = *pair.second;
+
+      node.nodeGeometry().setFont(font());
+
+      if (!node.group())
+        node.nodeGraphicsObject().relayout();
+    }
+  }
+
+  return QGraphicsScene::event(event);
+}
+
+
+void
+FlowScene::
+onPortsAboutToBeDeleted(Node& node,
+                        PortType portType,
+                        PortIndex first,
+                        PortIndex last)
+{
+  std::vector<Connection*> doomed;
+
+  auto const & entries = node.nodeState().getEntries(portType);
+
+  for (PortIndex i = first; i <= last; ++i)
+  {
+    for (auto const &pair : entries[i])
+      doomed.push_back(pair.second);
+  }
+
+  for (Connection* c : doomed)
+    deleteConnection(*c);
+}
+
+
+void
+FlowScene::
+connectNodeSignals(Node& node)
+{
+  Node* nodePtr = &node;
+
+  connect(node.nodeDataModel(), &NodeDataModel::portsAboutToBeDeleted, this,
+          [this, nodePtr](PortType portType, PortIndex first, PortIndex last)
+          {
+            onPortsAboutToBeDeleted(*nodePtr, portType, first, last);
+          });
+
+  // new outputs, and the inputs they reach, may exceed the budget
+  connect(node.nodeDataModel(), &NodeDataModel::dataUpdated,
+          this, &FlowScene::scheduleMemoryCheck);
+}
+
+
+void
+FlowScene::
+scheduleMemoryCheck()
+{
+  if (_memoryBudget == 0 || _memoryCheckPending)
+    return;
+
+  _memoryCheckPending = true;
+
+  QTimer::singleShot(0, this,
+                     [this]()
+                     {
+                       _memoryCheckPending = false;
+
+                       enforceMemoryBudget();
+                     });
 }
 
 
@@ -323,7 +666,7 @@ QPointF
 FlowScene::
 getNodePosition(const Node& node) const
 {
-  return node.nodeGraphicsObject().pos();
+  return node.position();
 }
 
 
@@ -331,8 +674,243 @@ void
 FlowScene::
 setNodePosition(Node& node, const QPointF& pos) const
 {
-  node.nodeGraphicsObject().setPos(pos);
-  node.nodeGraphicsObject().moveConnections();
+  // connections follow in NodeGraphicsObject::itemChange
+  node.setPosition(pos);
+}
+
+
+void
+FlowScene::
+moveNodes(std::vector<Node*> const& nodes, QPointF const& offset)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::moveNodes");
+
+  if (nodes.empty() || offset.isNull())
+    return;
+
+  // a connection between two moved nodes is updated only once
+  std::unordered_set<Connection*> connections;
+
+  _movingNodes = true;
+
+  for (Node* node : nodes)
+  {
+    // connections of collapsed nodes stay on the group's ports
+    if (node->group())
+    {
+      node->setPosition(node->position() + offset);
+      continue;
+    }
+
+    node->nodeGraphicsObject().moveBy(offset.x(), offset.y());
+
+    for (PortType portType : { PortType::In, PortType::Out })
+    {
+      for (auto const &entries : node->nodeState().getEntries(portType))
+      {
+        for (auto const &pair : entries)
+          connections.insert(pair.second);
+      }
+    }
+
+    if (auto group = dynamic_cast<NodeGroupModel*>(node->nodeDataModel()))
+    {
+      for (Connection* connection : group->boundaryConnections())
+        connections.insert(connection);
+    }
+  }
+
+  _movingNodes = false;
+
+  for (Connection* connection : connections)
+    connection->getConnectionGraphicsObject().move();
+
+  nodesMoved(nodes, offset);
+}
+
+
+void
+FlowScene::
+setNodePositions(std::vector<std::pair<Node*, QPointF> > const& positions)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::setNodePositions");
+
+  std::unordered_set<Connection*> connections;
+
+  _movingNodes = true;
+
+  for (auto const &entry : positions)
+  {
+    Node* node = entry.first;
+
+    node->setPosition(entry.second);
+
+    if (node->group())
+      continue;
+
+    for (PortType portType : { PortType::In, PortType::Out })
+    {
+      for (auto const &entries : node->nodeState().getEntries(portType))
+      {
+        for (auto const &pair : entries)
+          connections.insert(pair.second);
+      }
+    }
+
+    if (auto group = dynamic_cast<NodeGroupModel*>(node->nodeDataModel()))
+    {
+      for (Connection* connection : group->boundaryConnections())
+        connections.insert(connection);
+    }
+  }
+
+  _movingNodes = false;
+
+  for (Connection* connection : connections)
+    connection->getConnectionGraphicsObject().move();
+
+  for (auto const &entry : positions)
+    nodeMoved(*entry.first, entry.second);
+}
+
+
+Node*
+FlowScene::
+collapseNodes(std::vector<Node*> const& nodes)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::collapseNodes");
+
+  std::vector<Node*> inner;
+  std::unordered_set<Node const*> members;
+
+  for (Node* node : nodes)
+  {
+    // groups are not nested
+    if (node->group() || node->isGroup() || !members.insert(node).second)
+      continue;
+
+    inner.push_back(node);
+  }
+
+  if (inner.empty())
+    return nullptr;
+
+  QPointF origin = inner.front()->position();
+
+  for (Node* node : inner)
+  {
+    QPointF const pos = node->position();
+
+    origin.setX(std::min(origin.x(), pos.x()));
+    origin.setY(std::min(origin.y(), pos.y()));
+  }
+
+  // connections between inner nodes lose their items
+  std::vector<Connection*> collapsed;
+
+  for (Node* node : inner)
+  {
+    for (auto const &entries : node->nodeState().getEntries(PortType::Out))
+    {
+      for (auto const &pair : entries)
+      {
+        if (members.count(pair.second->getNode(PortType::In)))
+          collapsed.push_back(pair.second);
+      }
+    }
+  }
+
+  // one selection change instead of one per removed item
+  clearSelection();
+
+  std::vector<NodeDescription> descriptions;
+  descriptions.push_back({ std::make_unique<NodeGroupModel>(inner, origin),
+                           origin });
+
+  Node* group = createNodes(std::move(descriptions)).front();
+
+  for (Node* node : inner)
+  {
+    // the widget belongs to the model until the node is expanded
+    node->nodeGraphicsObject().releaseEmbeddedWidget();
+
+    node->setGraphicsObject(nullptr);
+    node->setGroup(group);
+  }
+
+  for (Connection* connection : collapsed)
+    connection->setGraphicsObject(nullptr);
+
+  // the boundary connections now end at the group's ports
+  group->nodeGraphicsObject().moveConnections();
+
+  nodesCollapsed(*group, inner);
+
+  return group;
+}
+
+
+std::vector<Node*>
+FlowScene::
+expandGroup(Node& group)
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::expandGroup");
+
+  auto groupModel = dynamic_cast<NodeGroupModel*>(group.nodeDataModel());
+
+  if (!groupModel)
+    return std::vector<Node*>();
+
+  std::vector<Node*> const inner = groupModel->nodes();
+
+  for (Node* node : inner)
+  {
+    QPointF const pos = node->position();
+
+    node->setGroup(nullptr);
+
+    node->setGraphicsObject(std::make_unique<NodeGraphicsObject>(*this, *node));
+
+    // not in the scene yet, so this does not signal a move
+    node->nodeGraphicsObject().setPos(pos);
+  }
+
+  std::unordered_set<Node const*> const members(inner.begin(), inner.end());
+
+  for (Node* node : inner)
+  {
+    addItem(&node->nodeGraphicsObject());
+
+    for (auto const &entries : node->nodeState().getEntries(PortType::Out))
+    {
+      for (auto const &pair : entries)
+      {
+        Connection* connection = pair.second;
+
+        if (!members.count(connection->getNode(PortType::In)))
+          continue;
+
+        auto cgo = std::make_unique<ConnectionGraphicsObject>(*this, *connection);
+
+        addItem(cgo.get());
+
+        connection->setGraphicsObject(std::move(cgo));
+      }
+    }
+  }
+
+  // the group has no connections of its own
+  nodeDeleted(group);
+
+  _nodes.erase(group.id());
+
+  // boundary connections return to the inner nodes
+  for (Node* node : inner)
+    node->nodeGraphicsObject().moveConnections();
+
+  nodesExpanded(inner);
+
+  return inner;
 }
 
 
@@ -383,25 +961,191 @@ selectedNodes() const
 }
 
 
-//------------------------------------------------------------------------------
+void
+FlowScene::
+setProfilingEnabled(bool enabled)
+{
+  _profilingEnabled = enabled;
+
+  for (auto const &pair : _nodes)
+    pair.second->setProfilingEnabled(enabled);
+}
+
 
 void
 FlowScene::
-clearScene()
+resetProfiles()
 {
-  //Manual node cleanup. Simply clearing the holding datastructures doesn't work, the code crashes when
-  // there are both nodes and connections in the scene. (The data propagation internal logic tries to propagate
-  // data through already freed connections.)
-  std::vector<Node*> nodesToDelete;
-  for (auto& node : _nodes)
+  for (auto const &pair : _nodes)
+    pair.second->resetProfile();
+
+  if (_profilingHeatmapVisible)
+    update();
+}
+
+
+std::vector<Node*>
+FlowScene::
+profiledNodes() const
+{
+  std::vector<Node*> result;
+
+  for (auto const &pair : _nodes)
   {
-    nodesToDelete.push_back(node.second.get());
+    if (pair.second->profile().calls > 0)
+      result.push_back(pair.second.get());
   }
 
-  for (auto& node : nodesToDelete)
+  std::sort(result.begin(), result.end(),
+            [](Node const* a, Node const* b)
+            {
+              return a->profile().selfNs > b->profile().selfNs;
+            });
+
+  return result;
+}
+
+
+void
+FlowScene::
+setProfilingHeatmapVisible(bool visible)
+{
+  if (_profilingHeatmapVisible == visible)
+    return;
+
+  _profilingHeatmapVisible = visible;
+
+  update();
+}
+
+
+std::size_t
+FlowScene::
+memoryUsage() const
+{
+  std::unordered_set<NodeData const*> counted;
+
+  std::size_t bytes = 0;
+
+  for (auto const &entry : _nodes)
+    bytes += entry.second->memoryUsage(&counted).total();
+
+  return bytes;
+}
+
+
+std::vector<std::pair<Node*, NodeMemoryUsage> >
+FlowScene::
+memoryUsageByNode() const
+{
+  std::vector<std::pair<Node*, NodeMemoryUsage> > result;
+  result.reserve(_nodes.size());
+
+  for (auto const &entry : _nodes)
+    result.emplace_back(entry.second.get(), entry.second->memoryUsage());
+
+  std::sort(result.begin(), result.end(),
+            [](std::pair<Node*, NodeMemoryUsage> const &a,
+               std::pair<Node*, NodeMemoryUsage> const &b)
+            {
+              return a.second.total() > b.second.total();
+            });
+
+  return result;
+}
+
+
+void
+FlowScene::
+setMemoryBudget(std::size_t bytes)
+{
+  _memoryBudget = bytes;
+
+  scheduleMemoryCheck();
+}
+
+
+std::size_t
+FlowScene::
+enforceMemoryBudget()
+{
+  std::size_t usage = memoryUsage();
+
+  if (_memoryBudget == 0 || usage <= _memoryBudget)
+    return usage;
+
+  memoryBudgetExceeded(usage, _memoryBudget);
+
+  // item caches are the cheapest to rebuild
+  QPixmapCache::clear();
+
+  for (auto const &entry : _nodes)
+    entry.second->releaseGraphicsCaches();
+
+  usage = memoryUsage();
+
+  if (usage <= _memoryBudget)
+    return usage;
+
+  // spilled payloads are read back on demand, cheaper than recomputing;
+  // the store is process-wide, only this scene's payloads are spilled
+  std::unordered_set<NodeData const*> payloads;
+
+  for (auto const &entry : _nodes)
+    entry.second->memoryUsage(&payloads);
+
+  DataRetention::release(payloads, usage - _memoryBudget);
+
+  usage = memoryUsage();
+
+  if (usage <= _memoryBudget)
+    return usage;
+
+  for (auto const &entry : memoryUsageByNode())
   {
-    removeNode(*node);
+    if (usage <= _memoryBudget)
+      break;
+
+    std::size_t const released =
+      entry.first->nodeDataModel()->releaseCachedData();
+
+    usage -= std::min(usage, released);
   }
+
+  // released outputs may still be held as inputs downstream
+  return memoryUsage();
+}
+
+
+//------------------------------------------------------------------------------
+
+void
+FlowScene::
+clearScene()
+{
+  NODE_EDITOR_TRACE_SCOPE("scene", "FlowScene::clearScene");
+
+  // one selection change instead of one per removed item
+  clearSelection();
+
+  // Detached connections do not propagate data on destruction, so the
+  // containers can be cleared without notifying nodes that are about
+  // to be freed. Node states are dropped with their nodes.
+  for (auto const &pair : _connections)
+  {
+    Connection &connection = *pair.second;
+
+    connectionDeleted(connection);
+
+    connection.clearNode(PortType::In);
+    connection.clearNode(PortType::Out);
+  }
+
+  for (auto const &pair : _nodes)
+    nodeDeleted(*pair.second);
+
+  _connections.clear();
+  _nodes.clear();
 }
 
 
@@ -461,14 +1205,30 @@ QByteArray
 FlowScene::
 saveToMemory() const
 {
+  NODE_EDITOR_TRACE_SCOPE("serialization", "FlowScene::saveToMemory");
+
   QJsonObject sceneJson;
 
   QJsonArray nodesJsonArray;
+  QJsonArray groupsJsonArray;
 
   for (auto const & pair : _nodes)
   {
     auto const &node = pair.second;
 
+    // a group is saved as the ids of its nodes, which are saved
+    // on their own at their current position
+    if (auto group = dynamic_cast<NodeGroupModel*>(node->nodeDataModel()))
+    {
+      QJsonArray idsJsonArray;
+
+      for (Node* inner : group->nodes())
+        idsJsonArray.append(inner->id().toString());
+
+      groupsJsonArray.append(idsJsonArray);
+      continue;
+    }
+
     nodesJsonArray.append(node->save());
   }
 
@@ -487,6 +1247,9 @@ saveToMemory() const
 
   sceneJson["connections"] = connectionJsonArray;
 
+  if (!groupsJsonArray.isEmpty())
+    sceneJson["groups"] = groupsJsonArray;
+
   QJsonDocument document(sceneJson);
 
   return document.toJson();
@@ -497,6 +1260,8 @@ void
 FlowScene::
 loadFromMemory(const QByteArray& data)
 {
+  NODE_EDITOR_TRACE_SCOPE("serialization", "FlowScene::loadFromMemory");
+
   QJsonObject const jsonDocument = QJsonDocument::fromJson(data).object();
 
   QJsonArray nodesJsonArray = jsonDocument["nodes"].toArray();
@@ -512,6 +1277,193 @@ loadFromMemory(const QByteArray& data)
   {
     restoreConnection(connectionJsonArray[i].toObject());
   }
+
+  for (QJsonValue const &groupJson : jsonDocument["groups"].toArray())
+  {
+    std::vector<Node*> members;
+
+    for (QJsonValue const &id : groupJson.toArray())
+    {
+      auto it = _nodes.find(QUuid(id.toString()));
+
+      if (it != _nodes.end())
+        members.push_back(it->second.get());
+    }
+
+    collapseNodes(members);
+  }
+}
+
+
+QString
+FlowScene::
+nodesMimeType()
+{
+  return QStringLiteral("application/x-qtnodes-nodes");
+}
+
+
+QByteArray
+FlowScene::
+copyNodes(std::vector<Node*> const& nodes) const
+{
+  NODE_EDITOR_TRACE_SCOPE("serialization", "FlowScene::copyNodes");
+
+  // a group is copied as the nodes it stands for
+  std::vector<Node*> copied;
+  copied.reserve(nodes.size());
+
+  for (Node* node : nodes)
+  {
+    if (auto group = dynamic_cast<NodeGroupModel*>(node->nodeDataModel()))
+      copied.insert(copied.end(), group->nodes().begin(), group->nodes().end());
+    else
+      copied.push_back(node);
+  }
+
+  if (copied.empty())
+    return QByteArray();
+
+  std::unordered_map<Node const*, int> indices;
+  indices.reserve(copied.size());
+
+  QPointF origin = copied.front()->position();
+
+  for (Node* node : copied)
+  {
+    indices.emplace(node, static_cast<int>(indices.size()));
+
+    QPointF const pos = node->position();
+
+    origin.setX(std::min(origin.x(), pos.x()));
+    origin.setY(std::min(origin.y(), pos.y()));
+  }
+
+  QJsonArray nodesJsonArray;
+
+  for (Node* node : copied)
+  {
+    QPointF const pos = node->position() - origin;
+
+    QJsonObject nodeJson;
+    nodeJson["model"] = node->nodeDataModel()->save();
+    nodeJson["x"]     = pos.x();
+    nodeJson["y"]     = pos.y();
+
+    nodesJsonArray.append(nodeJson);
+  }
+
+  // [out node, out port, in node, in port] for every internal connection
+  QJsonArray connectionJsonArray;
+
+  for (Node* node : copied)
+  {
+    for (auto const &entries : node->nodeState().getEntries(PortType::Out))
+    {
+      for (auto const &pair : entries)
+      {
+        Connection const* connection = pair.second;
+
+        auto in = indices.find(connection->getNode(PortType::In));
+
+        if (in == indices.end())
+          continue;
+
+        connectionJsonArray.append(
+          QJsonArray{ indices[node],
+                      connection->getPortIndex(PortType::Out),
+                      in->second,
+                      connection->getPortIndex(PortType::In) });
+      }
+    }
+  }
+
+  QJsonObject clipboardJson;
+  clipboardJson["nodes"]       = nodesJsonArray;
+  clipboardJson["connections"] = connectionJsonArray;
+
+  return QJsonDocument(clipboardJson).toJson(QJsonDocument::Compact);
+}
+
+
+std::vector<Node*>
+FlowScene::
+pasteNodes(QByteArray const& data, QPointF const& position)
+{
+  NODE_EDITOR_TRACE_SCOPE("serialization", "FlowScene::pasteNodes");
+
+  QJsonObject const clipboardJson = QJsonDocument::fromJson(data).object();
+
+  QJsonArray const nodesJsonArray = clipboardJson["nodes"].toArray();
+
+  std::vector<NodeDescription> descriptions;
+  descriptions.reserve(nodesJsonArray.size());
+
+  // clipboard index to index in `descriptions`, -1 for skipped nodes
+  std::vector<int> created(nodesJsonArray.size(), -1);
+
+  for (int i = 0; i < nodesJsonArray.size(); ++i)
+  {
+    QJsonObject const nodeJson  = nodesJsonArray[i].toObject();
+    QJsonObject const modelJson = nodeJson["model"].toObject();
+
+    auto dataModel = registry().create(modelJson["name"].toString());
+
+    if (!dataModel)
+      continue;
+
+    // restored before the node exists, so the ports are final
+    dataModel->restore(modelJson);
+
+    created[i] = static_cast<int>(descriptions.size());
+
+    descriptions.push_back({ std::move(dataModel),
+                             position + QPointF(nodeJson["x"].toDouble(),
+                                                nodeJson["y"].toDouble()) });
+  }
+
+  std::vector<Node*> nodes = createNodes(std::move(descriptions));
+
+  std::vector<ConnectionDescription> connections;
+
+  for (QJsonValue const &value : clipboardJson["connections"].toArray())
+  {
+    QJsonArray const c = value.toArray();
+
+    int const out = c[0].toInt(-1);
+    int const in  = c[2].toInt(-1);
+
+    auto isCreated =
+      [&created](int index)
+      {
+        return index >= 0 &&
+               index < static_cast<int>(created.size()) &&
+               created[index] >= 0;
+      };
+
+    if (!isCreated(out) || !isCreated(in))
+      continue;
+
+    Node* nodeOut = nodes[created[out]];
+    Node* nodeIn  = nodes[created[in]];
+
+    PortIndex const portOut = c[1].toInt(INVALID);
+    PortIndex const portIn  = c[3].toInt(INVALID);
+
+    auto const nOut = nodeOut->nodeDataModel()->nPorts(PortType::Out);
+    auto const nIn  = nodeIn->nodeDataModel()->nPorts(PortType::In);
+
+    if (portOut < 0 || static_cast<unsigned int>(portOut) >= nOut ||
+        portIn < 0 || static_cast<unsigned int>(portIn) >= nIn)
+      continue;
+
+    connections.push_back({ nodeIn, portIn, nodeOut, portOut });
+  }
+
+  if (!connections.empty())
+    createConnections(connections);
+
+  return nodes;
 }
 
 
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <QtCore/QUuid>
+#include <QtCore/QPointF>
 #include <QtWidgets/QGraphicsScene>
 
 #include <unordered_map>
+#include <vector>
 #include <tuple>
 #include <memory>
 #include <functional>
@@ -11,6 +13,7 @@
 #include "Connection.hpp"
 #include "Export.hpp"
 #include "DataModelRegistry.hpp"
+#include "NodeMemoryUsage.hpp"
 
 namespace QtNodes
 {
@@ -22,6 +25,24 @@ class NodeGraphicsObject;
 class ConnectionGraphicsObject;
 class NodeStyle;
 
+/// Input of FlowScene::createNodes
+struct NodeDescription
+{
+  std::unique_ptr<NodeDataModel> model;
+
+  QPointF position;
+};
+
+/// Input of FlowScene::createConnections
+struct ConnectionDescription
+{
+  Node*     nodeIn;
+  PortIndex portIndexIn;
+
+  Node*     nodeOut;
+  PortIndex portIndexOut;
+};
+
 /// Scene holds connections and nodes.
 class NODE_EDITOR_PUBLIC FlowScene
   : public QGraphicsScene
@@ -50,18 +71,40 @@ public:
   std::shared_ptr<Connection>
   restoreConnection(QJsonObject const &connectionJson);
 
+  /// Creates all connections and adds their items to the scene at once.
+  /// Data is pushed only from the nodes not fed by the batch, and from
+  /// one node per unreached cycle; propagation carries it through the
+  /// rest, so a chain costs one evaluation per link. Out-ports that
+  /// propagation reached without their model re-emitting then push
+  /// their current data once. Connections
+  /// inside a collapsed group get no item until the group is expanded.
+  /// Emits one `connectionsCreated` instead of `connectionCreated`.
+  std::vector<std::shared_ptr<Connection> >
+  createConnections(std::vector<ConnectionDescription> const& descriptions);
+
   void
   deleteConnection(Connection& connection);
 
   Node&
   createNode(std::unique_ptr<NodeDataModel> && dataModel);
 
+  /// Creates and positions all nodes before adding any of them to
+  /// the scene. Emits one `nodesCreated` instead of `nodeCreated`.
+  std::vector<Node*>
+  createNodes(std::vector<NodeDescription> && descriptions);
+
   Node&
   restoreNode(QJsonObject const& nodeJson);
 
   void
   removeNode(Node& node);
 
+  /// Removes all `nodes` and their connections at once.
+  /// Connections between removed nodes are torn down without
+  /// propagating empty data, only surviving nodes are notified.
+  void
+  removeNodes(std::vector<Node*> const& nodes);
+
   DataModelRegistry&
   registry() const;
 
@@ -82,6 +125,21 @@ public:
 
   void
   setNodePosition(Node& node, const QPointF& pos) const;
+
+  /// Translates all `nodes` by `offset`, updates every attached
+  /// connection once and emits a single `nodesMoved`.
+  /// Per-node `nodeMoved` signals are not emitted.
+  void
+  moveNodes(std::vector<Node*> const& nodes, QPointF const& offset);
+
+  /// Moves every node to its own position, updates each attached
+  /// connection once and emits `nodeMoved` per node
+  void
+  setNodePositions(std::vector<std::pair<Node*, QPointF> > const& positions);
+
+  /// True while moveNodes() or setNodePositions() reposition the nodes
+  bool
+  isMovingNodes() const { return _movingNodes; }
   
   QSizeF
   getNodeSize(const Node& node) const;
@@ -96,8 +154,60 @@ public:
   std::vector<Node*>
   selectedNodes() const;
 
+public: // profiling
+
+  bool
+  isProfilingEnabled() const { return _profilingEnabled; }
+
+  /// Times every node's setInData calls, see Node::profile()
+  void
+  setProfilingEnabled(bool enabled);
+
+  void
+  resetProfiles();
+
+  /// Profiled nodes, the most expensive (by self time) first
+  std::vector<Node*>
+  profiledNodes() const;
+
+  bool
+  isProfilingHeatmapVisible() const { return _profilingHeatmapVisible; }
+
+  /// Tints nodes by their cost and shows timings as a badge
+  void
+  setProfilingHeatmapVisible(bool visible);
+
+public: // memory accounting
+
+  /// Bytes held by all nodes; data shared between ports
+  /// and nodes is counted once
+  std::size_t
+  memoryUsage() const;
+
+  /// Usage of every node, the largest first. Shared data is
+  /// counted in each node holding it.
+  std::vector<std::pair<Node*, NodeMemoryUsage> >
+  memoryUsageByNode() const;
+
+  std::size_t
+  memoryBudget() const { return _memoryBudget; }
+
+  /// Limits memoryUsage(), 0 disables the limit. The budget is
+  /// checked once per event loop iteration after data has changed.
+  void
+  setMemoryBudget(std::size_t bytes);
+
+  /// Frees memory until the usage fits the budget: item caches are
+  /// dropped first, then RetainedData payloads on this scene's ports
+  /// are spilled, then models release cached data, largest nodes first.
+  /// Returns the resulting usage.
+  std::size_t
+  enforceMemoryBudget();
+
 public:
 
+  /// Deletes everything without any data propagation,
+  /// deletion signals are still emitted
   void
   clearScene();
 
@@ -113,22 +223,76 @@ public:
   void 
   loadFromMemory(const QByteArray& data);
 
+public: // clipboard
+
+  /// Mime type of copyNodes() data on the clipboard
+  static
+  QString
+  nodesMimeType();
+
+  /// Serializes `nodes` and the connections between them. Nodes are
+  /// referenced by their index instead of their id and positions are
+  /// relative to the top left node, see pasteNodes().
+  QByteArray
+  copyNodes(std::vector<Node*> const& nodes) const;
+
+  /// Instantiates copyNodes() data with new ids through createNodes()
+  /// and createConnections(), with the top left node at `position`.
+  /// Models not in the registry are skipped with their connections.
+  /// Pasted nodes are evaluated once per pasted input connection.
+  std::vector<Node*>
+  pasteNodes(QByteArray const& data, QPointF const& position);
+
+public: // grouping
+
+  /// Replaces `nodes` by one group node at their top left position,
+  /// whose ports are the inner ports with connections to other nodes.
+  /// The graphics objects of the nodes and of the connections between
+  /// them are destroyed; models, connections and data propagation
+  /// stay unchanged. Nodes already collapsed and group nodes are
+  /// skipped. Returns the group node, nullptr if nothing was collapsed.
+  Node*
+  collapseNodes(std::vector<Node*> const& nodes);
+
+  /// Recreates the graphics objects of the group's nodes, moved by
+  /// the distance the group node was moved, and removes the group
+  /// node. Returns the expanded nodes.
+  std::vector<Node*>
+  expandGroup(Node& group);
+
   signals:
 
   void
   nodeCreated(Node &n);
 
+  void
+  nodesCreated(std::vector<Node*> const& nodes);
+
   void
   nodeDeleted(Node &n);
 
   void
   connectionCreated(Connection &c);
+
+  void
+  connectionsCreated(std::vector<Connection*> const& connections);
   void
   connectionDeleted(Connection &c);
 
   void
   nodeMoved(Node& n, const QPointF& newLocation);
 
+  void
+  nodesMoved(std::vector<Node*> const& nodes, QPointF const& offset);
+
+  /// Emitted after `nodes` were collapsed into the new `group`
+  void
+  nodesCollapsed(Node& group, std::vector<Node*> const& nodes);
+
+  /// Emitted after the group of `nodes` was expanded and removed
+  void
+  nodesExpanded(std::vector<Node*> const& nodes);
+
   void
   nodeDoubleClicked(Node& n);
 
@@ -144,6 +308,33 @@ public:
   void
   nodeHoverLeft(Node& n);
 
+  /// Emitted before memory is freed to meet the budget
+  void
+  memoryBudgetExceeded(std::size_t usage, std::size_t budget);
+
+protected:
+
+  /// Re-lays out all nodes when the scene font changes
+  bool
+  event(QEvent* event) override;
+
+private:
+
+  /// Deletes the connections of ports the node's model is about to remove
+  void
+  onPortsAboutToBeDeleted(Node& node,
+                          PortType portType,
+                          PortIndex first,
+                          PortIndex last);
+
+  void
+  connectNodeSignals(Node& node);
+
+  /// Runs enforceMemoryBudget() from the event loop, once for
+  /// any number of calls in between
+  void
+  scheduleMemoryCheck();
+
 private:
 
   using SharedConnection = std::shared_ptr<Connection>;
@@ -152,6 +343,14 @@ private:
   std::unordered_map<QUuid, SharedConnection> _connections;
   std::unordered_map<QUuid, UniqueNode>       _nodes;
   std::shared_ptr<DataModelRegistry>          _registry;
+
+  bool _movingNodes;
+
+  bool _profilingEnabled;
+  bool _profilingHeatmapVisible;
+
+  std::size_t _memoryBudget;
+  bool        _memoryCheckPending;
 };
 
 Node*
@@ -7,6 +7,8 @@
 #include <QtWidgets/QMenu>
 
 #include <QtCore/QRectF>
+#include <QtCore/QElapsedTimer>
+#include <QtGui/QPixmapCache>
 
 #include <QtOpenGL>
 #include <QtWidgets>
@@ -14,21 +16,49 @@
 #include <QDebug>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 #include "FlowScene.hpp"
 #include "DataModelRegistry.hpp"
 #include "Node.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "ConnectionGraphicsObject.hpp"
+#include "SceneLayout.hpp"
 #include "StyleCollection.hpp"
+#include "Trace.hpp"
 
 using QtNodes::FlowView;
 using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::SceneLayout;
+using QtNodes::RenderCounters;
+using QtNodes::FrameStatistics;
+
+namespace
+{
+
+double const fineGridStep   = 15.0;
+double const coarseGridStep = 150.0;
+
+/// On-screen line spacing, in pixels, over which fine lines fade out
+double const gridFadeEnd   = 8.0;
+double const gridFadeStart = 4.0;
+
+/// Statistics overlay layout, in pixels and text lines
+int const overlayMargin  = 8;
+int const overlayPadding = 6;
+int const overlayLines   = 5;
+int const overlayColumns = 44;
+}
 
 FlowView::
 FlowView(FlowScene *scene)
   : QGraphicsView(scene)
   , _scene(scene)
+  , _statisticsOverlayVisible(false)
+  , _backgroundNs(0)
+  , _frameTimes(frameHistorySize(), 0)
+  , _frameCount(0)
 {
   setDragMode(QGraphicsView::ScrollHandDrag);
   setRenderHint(QPainter::Antialiasing);
@@ -58,6 +88,36 @@ FlowView(FlowScene *scene)
   _deleteSelectionAction->setShortcut(Qt::Key_Delete);
   connect(_deleteSelectionAction, &QAction::triggered, this, &FlowView::deleteSelectedNodes);
   addAction(_deleteSelectionAction);
+
+  _copySelectionAction = new QAction(QStringLiteral("Copy"), this);
+  _copySelectionAction->setShortcut(QKeySequence::Copy);
+  connect(_copySelectionAction, &QAction::triggered, this, &FlowView::copySelectedNodes);
+  addAction(_copySelectionAction);
+
+  _pasteAction = new QAction(QStringLiteral("Paste"), this);
+  _pasteAction->setShortcut(QKeySequence::Paste);
+  connect(_pasteAction, &QAction::triggered, this, &FlowView::pasteNodes);
+  addAction(_pasteAction);
+
+  _duplicateSelectionAction = new QAction(QStringLiteral("Duplicate"), this);
+  _duplicateSelectionAction->setShortcut(Qt::CTRL + Qt::Key_D);
+  connect(_duplicateSelectionAction, &QAction::triggered, this, &FlowView::duplicateSelectedNodes);
+  addAction(_duplicateSelectionAction);
+
+  _collapseSelectionAction = new QAction(QStringLiteral("Collapse Selection"), this);
+  _collapseSelectionAction->setShortcut(Qt::CTRL + Qt::Key_G);
+  connect(_collapseSelectionAction, &QAction::triggered, this, &FlowView::collapseSelectedNodes);
+  addAction(_collapseSelectionAction);
+
+  _expandSelectionAction = new QAction(QStringLiteral("Expand Selected Groups"), this);
+  _expandSelectionAction->setShortcut(Qt::CTRL + Qt::SHIFT + Qt::Key_G);
+  connect(_expandSelectionAction, &QAction::triggered, this, &FlowView::expandSelectedGroups);
+  addAction(_expandSelectionAction);
+
+  _autoLayoutAction = new QAction(QStringLiteral("Auto Layout"), this);
+  _autoLayoutAction->setShortcut(Qt::CTRL + Qt::Key_L);
+  connect(_autoLayoutAction, &QAction::triggered, this, &FlowView::autoLayout);
+  addAction(_autoLayoutAction);
 }
 
 
@@ -77,6 +137,123 @@ deleteSelectionAction() const
 }
 
 
+QAction*
+FlowView::
+copySelectionAction() const
+{
+  return _copySelectionAction;
+}
+
+
+QAction*
+FlowView::
+pasteAction() const
+{
+  return _pasteAction;
+}
+
+
+QAction*
+FlowView::
+duplicateSelectionAction() const
+{
+  return _duplicateSelectionAction;
+}
+
+
+QAction*
+FlowView::
+collapseSelectionAction() const
+{
+  return _collapseSelectionAction;
+}
+
+
+QAction*
+FlowView::
+expandSelectionAction() const
+{
+  return _expandSelectionAction;
+}
+
+
+QAction*
+FlowView::
+autoLayoutAction() const
+{
+  return _autoLayoutAction;
+}
+
+
+double
+FlowView::
+frameTimePercentile(double percentile) const
+{
+  std::size_t const n = std::min(_frameCount, _frameTimes.size());
+
+  if (n == 0)
+    return 0.0;
+
+  std::vector<qint64> times(_frameTimes.begin(), _frameTimes.begin() + n);
+
+  double const p = std::min(100.0, std::max(0.0, percentile));
+
+  // nearest rank
+  std::size_t const rank  = std::size_t(std::ceil(p / 100.0 * n));
+  std::size_t const index = std::max<std::size_t>(rank, 1) - 1;
+
+  std::nth_element(times.begin(), times.begin() + index, times.end());
+
+  return times[index] / 1e6;
+}
+
+
+std::size_t
+FlowView::
+frameHistorySize()
+{
+  return 240;
+}
+
+
+int
+FlowView::
+pendingInvalidations() const
+{
+  int count = 0;
+
+  for (auto const &entry : _scene->nodes())
+  {
+    if (entry.second->nodeGeometry().isDirty())
+      ++count;
+  }
+
+  return count;
+}
+
+
+void
+FlowView::
+resetStatistics()
+{
+  _lastFrame = FrameStatistics();
+
+  std::fill(_frameTimes.begin(), _frameTimes.end(), 0);
+
+  _frameCount = 0;
+}
+
+
+void
+FlowView::
+setStatisticsOverlayVisible(bool visible)
+{
+  _statisticsOverlayVisible = visible;
+
+  viewport()->update(statisticsOverlayRect());
+}
+
+
 void
 FlowView::
 contextMenuEvent(QContextMenuEvent *event)
@@ -234,11 +411,7 @@ FlowView::
 deleteSelectedNodes()
 {
   // delete the nodes, this will delete many of the connections
-  for (QGraphicsItem * item : _scene->selectedItems())
-  {
-    if (auto n = qgraphicsitem_cast<NodeGraphicsObject*>(item))
-      _scene->removeNode(n->node());
-  }
+  _scene->removeNodes(_scene->selectedNodes());
 
   for (QGraphicsItem * item : _scene->selectedItems())
   {
@@ -248,6 +421,125 @@ deleteSelectedNodes()
 }
 
 
+void
+FlowView::
+copySelectedNodes()
+{
+  std::vector<Node*> const nodes = _scene->selectedNodes();
+
+  if (nodes.empty())
+    return;
+
+  auto mimeData = new QMimeData;
+  mimeData->setData(FlowScene::nodesMimeType(), _scene->copyNodes(nodes));
+
+  QApplication::clipboard()->setMimeData(mimeData);
+}
+
+
+void
+FlowView::
+pasteNodes()
+{
+  QMimeData const* mimeData = QApplication::clipboard()->mimeData();
+
+  if (!mimeData || !mimeData->hasFormat(FlowScene::nodesMimeType()))
+    return;
+
+  // under the cursor, or in the middle of the view
+  QPoint const cursor = viewport()->mapFromGlobal(QCursor::pos());
+
+  QPointF const position = viewport()->rect().contains(cursor)
+                           ? mapToScene(cursor)
+                           : mapToScene(viewport()->rect().center());
+
+  selectNodes(_scene->pasteNodes(mimeData->data(FlowScene::nodesMimeType()),
+                                 position));
+}
+
+
+void
+FlowView::
+duplicateSelectedNodes()
+{
+  std::vector<Node*> const nodes = _scene->selectedNodes();
+
+  if (nodes.empty())
+    return;
+
+  QPointF topLeft = nodes.front()->nodeGraphicsObject().pos();
+
+  for (Node* node : nodes)
+  {
+    QPointF const pos = node->nodeGraphicsObject().pos();
+
+    topLeft.setX(std::min(topLeft.x(), pos.x()));
+    topLeft.setY(std::min(topLeft.y(), pos.y()));
+  }
+
+  // two fine grid cells down and to the right of the originals
+  QPointF const offset(2 * fineGridStep, 2 * fineGridStep);
+
+  selectNodes(_scene->pasteNodes(_scene->copyNodes(nodes), topLeft + offset));
+}
+
+
+void
+FlowView::
+collapseSelectedNodes()
+{
+  if (Node* group = _scene->collapseNodes(_scene->selectedNodes()))
+    selectNodes({ group });
+}
+
+
+void
+FlowView::
+expandSelectedGroups()
+{
+  std::vector<Node*> expanded;
+
+  for (Node* node : _scene->selectedNodes())
+  {
+    if (!node->isGroup())
+      continue;
+
+    std::vector<Node*> const nodes = _scene->expandGroup(*node);
+
+    expanded.insert(expanded.end(), nodes.begin(), nodes.end());
+  }
+
+  if (!expanded.empty())
+    selectNodes(expanded);
+}
+
+
+void
+FlowView::
+autoLayout()
+{
+  SceneLayout().layout(*_scene);
+}
+
+
+void
+FlowView::
+selectNodes(std::vector<Node*> const& nodes)
+{
+  {
+    // one selectionChanged for the whole selection
+    QSignalBlocker blocker(_scene);
+
+    _scene->clearSelection();
+
+    for (Node* node : nodes)
+      node->nodeGraphicsObject().setSelected(true);
+  }
+
+  _scene->selectionChanged();
+}
+
+
 void
 FlowView::
 keyPressEvent(QKeyEvent *event)
@@ -287,51 +579,218 @@ void
 FlowView::
 drawBackground(QPainter* painter, const QRectF& r)
 {
+  NODE_EDITOR_TRACE_SCOPE("paint", "FlowView::drawBackground");
+
+  QElapsedTimer timer;
+  timer.start();
+
   QGraphicsView::drawBackground(painter, r);
 
-  auto drawGrid =
-    [&](double gridStep)
-    {
-      QRect   windowRect = rect();
-      QPointF tl = mapToScene(windowRect.topLeft());
-      QPointF br = mapToScene(windowRect.bottomRight());
+  double const scale = transform().m11();
 
-      double left   = std::floor(tl.x() / gridStep - 0.5);
-      double right  = std::floor(br.x() / gridStep + 1.0);
-      double bottom = std::floor(tl.y() / gridStep - 0.5);
-      double top    = std::floor (br.y() / gridStep + 1.0);
+  // the coarse grid would be a solid wash of lines
+  if (coarseGridStep * scale < gridFadeStart)
+  {
+    _backgroundNs += timer.nsecsElapsed();
+    return;
+  }
 
-      // vertical lines
-      for (int xi = int(left); xi <= int(right); ++xi)
-      {
-        QLineF line(xi * gridStep, bottom * gridStep,
-                    xi * gridStep, top * gridStep );
+  QPixmap const tile = gridTile(scale);
 
-        painter->drawLine(line);
-      }
+  // one tile covers one coarse cell; texture brushes follow the world
+  // transform, so the pattern stays anchored at the scene origin
+  double const tileScale = coarseGridStep / tile.width();
+
+  QBrush brush(tile);
+  brush.setTransform(QTransform::fromScale(tileScale, tileScale));
+
+  painter->fillRect(r, brush);
+
+  _backgroundNs += timer.nsecsElapsed();
+}
+
+
+void
+FlowView::
+drawForeground(QPainter* painter, const QRectF& r)
+{
+  QGraphicsView::drawForeground(painter, r);
+
+  if (!_statisticsOverlayVisible)
+    return;
+
+  RenderCounters const &counters = _lastFrame.counters;
+
+  auto ms = [](double value) { return QString::number(value, 'f', 2); };
+
+  auto percent =
+    [](double rate) { return QString::number(int(std::round(rate * 100.0))); };
+
+  QString const lines[overlayLines] =
+  {
+    QStringLiteral("frame %1 ms  p50 %2  p95 %3  p99 %4")
+    .arg(ms(_lastFrame.frameMs))
+    .arg(ms(frameTimePercentile(50.0)))
+    .arg(ms(frameTimePercentile(95.0)))
+    .arg(ms(frameTimePercentile(99.0))),
+    QStringLiteral("background %1 ms").arg(ms(_lastFrame.backgroundMs)),
+    QStringLiteral("painted %1 nodes  %2 connections")
+    .arg(counters.paintedNodes)
+    .arg(counters.paintedConnections),
+    QStringLiteral("layouts %1  pending %2")
+    .arg(counters.layouts)
+    .arg(pendingInvalidations()),
+    QStringLiteral("text cache %1%  sprite cache %2%")
+    .arg(percent(counters.textCacheHitRate()))
+    .arg(percent(counters.spriteCacheHitRate()))
+  };
+
+  QRect const rect = statisticsOverlayRect();
+
+  QFontMetrics const metrics = fontMetrics();
+
+  painter->save();
+
+  // the overlay stays in viewport coordinates
+  painter->resetTransform();
+  painter->setFont(font());
+
+  painter->setPen(Qt::NoPen);
+  painter->setBrush(QColor(0, 0, 0, 170));
+  painter->drawRect(rect);
+
+  painter->setPen(Qt::white);
+
+  int y = rect.top() + overlayPadding + metrics.ascent();
+
+  for (QString const &line : lines)
+  {
+    painter->drawText(QPoint(rect.left() + overlayPadding, y), line);
+
+    y += metrics.height();
+  }
+
+  painter->restore();
+}
+
+
+void
+FlowView::
+paintEvent(QPaintEvent *event)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  RenderCounters const before = RenderCounters::snapshot();
+
+  _backgroundNs = 0;
+
+  QGraphicsView::paintEvent(event);
+
+  qint64 const frameNs = timer.nsecsElapsed();
+
+  QRect const overlay = _statisticsOverlayVisible ? statisticsOverlayRect()
+                                                  : QRect();
+
+  // the overlay's own follow-up repaint is not a frame of the scene
+  if (overlay.isNull() || !event->region().subtracted(overlay).isEmpty())
+  {
+    _lastFrame.frameMs      = frameNs / 1e6;
+    _lastFrame.backgroundMs = _backgroundNs / 1e6;
+    _lastFrame.counters     = RenderCounters::snapshot() - before;
+
+    _frameTimes[_frameCount % _frameTimes.size()] = frameNs;
+
+    ++_frameCount;
+  }
+
+  // a partial update left the overlay stale; the follow-up
+  // frame covers it, so this does not repaint endlessly
+  if (!overlay.isNull() &&
+      event->region().intersected(overlay) != QRegion(overlay))
+    viewport()->update(overlay);
+}
+
+
+QRect
+FlowView::
+statisticsOverlayRect() const
+{
+  QFontMetrics const metrics = fontMetrics();
+
+  return QRect(overlayMargin,
+               overlayMargin,
+               overlayColumns * metrics.averageCharWidth() + 2 * overlayPadding,
+               overlayLines * metrics.height() + 2 * overlayPadding);
+}
 
-      // horizontal lines
-      for (int yi = int(bottom); yi <= int(top); ++yi)
-      {
-        QLineF line(left * gridStep, yi * gridStep,
-                    right * gridStep, yi * gridStep );
-        painter->drawLine(line);
-      }
-    };
 
+QPixmap
+FlowView::
+gridTile(double scale) const
+{
   auto const &flowViewStyle = StyleCollection::flowViewStyle();
 
-  QBrush bBrush = backgroundBrush();
+  // an eighth of an octave is close enough to the real zoom to keep
+  // lines crisp while bounding the number of distinct tiles
+  double const bucket = std::pow(2.0, std::round(std::log2(scale) * 8.0) / 8.0);
+
+  int const tileSize = std::max(1, int(std::round(coarseGridStep * bucket)));
+
+  QString const key = QStringLiteral("qtnodes-grid:%1:%2:%3:%4")
+                      .arg(tileSize)
+                      .arg(flowViewStyle.BackgroundColor.rgba(), 0, 16)
+                      .arg(flowViewStyle.FineGridColor.rgba(), 0, 16)
+                      .arg(flowViewStyle.CoarseGridColor.rgba(), 0, 16);
+
+  QPixmap tile;
+
+  if (QPixmapCache::find(key, &tile))
+    return tile;
+
+  tile = QPixmap(tileSize, tileSize);
+  tile.fill(flowViewStyle.BackgroundColor);
 
-  QPen pfine(flowViewStyle.FineGridColor, 1.0);
+  double const pixelsPerUnit = tileSize / coarseGridStep;
+  double const fineSpacing   = fineGridStep * pixelsPerUnit;
+
+  QPainter p(&tile);
+
+  double const fineAlpha =
+    std::min(1.0, std::max(0.0, (fineSpacing - gridFadeStart) /
+                                (gridFadeEnd - gridFadeStart)));
+
+  if (fineAlpha > 0.0)
+  {
+    QColor fine = flowViewStyle.FineGridColor;
+    fine.setAlphaF(fine.alphaF() * fineAlpha);
+
+    p.setPen(QPen(fine, std::max(1.0, pixelsPerUnit)));
+
+    int const nFine = int(std::round(coarseGridStep / fineGridStep));
+
+    for (int i = 1; i < nFine; ++i)
+    {
+      double const x = i * fineSpacing;
+
+      p.drawLine(QLineF(x, 0.0, x, tileSize));
+      p.drawLine(QLineF(0.0, x, tileSize, x));
+    }
+  }
+
+  p.setPen(QPen(flowViewStyle.CoarseGridColor, std::max(1.0, pixelsPerUnit)));
+  // both tile edges, so each neighbouring tile shows its half of the line
+  for (double x : { 0.0, double(tileSize) })
+  {
+    p.drawLine(QLineF(x, 0.0, x, tileSize));
+    p.drawLine(QLineF(0.0, x, tileSize, x));
+  }
 
-  painter->setPen(pfine);
-  drawGrid(15);
+  p.end();
 
-  QPen p(flowViewStyle.CoarseGridColor, 1.0);
+  QPixmapCache::insert(key, tile);
 
-  painter->setPen(p);
-  drawGrid(150);
+  return tile;
 }
 
 
@@ -1,13 +1,17 @@
 #pragma once
 
+#include <vector>
+
 #include <QtWidgets/QGraphicsView>
 
 #include "Export.hpp"
+#include "RenderStatistics.hpp"
 
 namespace QtNodes
 {
 
 class FlowScene;
+class Node;
 
 class NODE_EDITOR_PUBLIC FlowView
   : public QGraphicsView
@@ -23,6 +27,39 @@ public:
 
   QAction* deleteSelectionAction() const;
 
+  QAction* copySelectionAction() const;
+
+  QAction* pasteAction() const;
+
+  QAction* duplicateSelectionAction() const;
+
+  QAction* collapseSelectionAction() const;
+
+  QAction* expandSelectionAction() const;
+
+  QAction* autoLayoutAction() const;
+
+  /// Measurements of the last painted frame. Repaints of only the
+  /// statistics overlay are not frames and are not recorded.
+  FrameStatistics const& lastFrameStatistics() const { return _lastFrame; }
+
+  /// Frame time in milliseconds that `percentile` percent of the
+  /// recent frames did not exceed, 0 before the first frame
+  double frameTimePercentile(double percentile) const;
+
+  /// Number of frames kept for the percentiles
+  static std::size_t frameHistorySize();
+
+  /// Nodes whose layout is invalidated but not yet recomputed
+  int pendingInvalidations() const;
+
+  void resetStatistics();
+
+  bool isStatisticsOverlayVisible() const { return _statisticsOverlayVisible; }
+
+  /// Shows the frame statistics in the top left corner of the view
+  void setStatisticsOverlayVisible(bool visible);
+
 public slots:
 
   void scaleUp();
@@ -31,6 +68,23 @@ public slots:
 
   void deleteSelectedNodes();
 
+  /// Puts the selected nodes and their connections on the clipboard
+  void copySelectedNodes();
+
+  /// Pastes clipboard nodes under the cursor and selects them
+  void pasteNodes();
+
+  /// Copies the selected nodes next to themselves and selects the copies
+  void duplicateSelectedNodes();
+
+  /// Collapses the selected nodes into a group node, see FlowScene::collapseNodes()
+  void collapseSelectedNodes();
+
+  void expandSelectedGroups();
+
+  /// Arranges all nodes with SceneLayout
+  void autoLayout();
+
 protected:
 
   void contextMenuEvent(QContextMenuEvent *event) override;
@@ -43,13 +97,43 @@ protected:
 
   void drawBackground(QPainter* painter, const QRectF& r) override;
 
+  void drawForeground(QPainter* painter, const QRectF& r) override;
+
+  void paintEvent(QPaintEvent *event) override;
+
   void showEvent(QShowEvent *event) override;
 
 private:
 
+  /// One coarse grid cell rasterized for the given view scale.
+  /// Tiles are shared through QPixmapCache per eighth-octave zoom bucket.
+  QPixmap gridTile(double scale) const;
+
+  /// Viewport area covered by the statistics overlay
+  QRect statisticsOverlayRect() const;
+
+  void selectNodes(std::vector<Node*> const& nodes);
+
   QAction* _clearSelectionAction;
   QAction* _deleteSelectionAction;
+  QAction* _copySelectionAction;
+  QAction* _pasteAction;
+  QAction* _duplicateSelectionAction;
+  QAction* _collapseSelectionAction;
+  QAction* _expandSelectionAction;
+  QAction* _autoLayoutAction;
 
   FlowScene* _scene;
+
+  bool _statisticsOverlayVisible;
+
+  FrameStatistics _lastFrame;
+
+  /// Background time of the frame being painted
+  qint64 _backgroundNs;
+
+  /// Ring buffer of recent frame times in nanoseconds
+  std::vector<qint64> _frameTimes;
+  std::size_t         _frameCount;
 };
 }
@@ -0,0 +1,225 @@
+#include "Logging.hpp"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <QtCore/QFile>
+
+using QtNodes::Logging;
+
+namespace QtNodes
+{
+
+Q_LOGGING_CATEGORY(lifetimeLog, "qtnodes.lifetime", QtWarningMsg)
+}
+
+namespace
+{
+
+/// Writes queued messages from its own thread
+class AsyncSink
+{
+public:
+
+  AsyncSink(QString const& fileName)
+    : _fileName(fileName)
+  {}
+
+  ~AsyncSink()
+  {
+    if (!_worker.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      _stop = true;
+    }
+
+    _wake.notify_one();
+
+    _worker.join();
+  }
+
+  bool
+  start()
+  {
+    bool opened = false;
+
+    if (_fileName.isEmpty())
+    {
+      opened = _file.open(stderr, QIODevice::WriteOnly);
+    }
+    else
+    {
+      _file.setFileName(_fileName);
+
+      opened = _file.open(QIODevice::WriteOnly |
+                          QIODevice::Append |
+                          QIODevice::Text);
+    }
+
+    if (opened)
+      _worker = std::thread([this] { run(); });
+
+    return opened;
+  }
+
+  void
+  post(QString message)
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+
+      _queue.push_back(std::move(message));
+    }
+
+    _wake.notify_one();
+  }
+
+  /// True on the thread writing the queue, which cannot wait for it
+  bool
+  isWorkerThread() const
+  {
+    return std::this_thread::get_id() == _worker.get_id();
+  }
+
+private:
+
+  void
+  run()
+  {
+    std::deque<QString> batch;
+
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        _wake.wait(lock, [this] { return _stop || !_queue.empty(); });
+
+        if (_queue.empty())
+          return;
+
+        batch.swap(_queue);
+      }
+
+      for (QString const &message : batch)
+      {
+        _file.write(message.toLocal8Bit());
+        _file.write("\n", 1);
+      }
+
+      _file.flush();
+
+      batch.clear();
+    }
+  }
+
+private:
+
+  QString _fileName;
+  QFile   _file;
+
+  std::mutex              _mutex;
+  std::condition_variable _wake;
+  std::deque<QString>     _queue;
+  bool                    _stop = false;
+
+  std::thread _worker;
+};
+
+
+/// Guards the installed sink against concurrent removal
+std::mutex sinkMutex;
+
+std::unique_ptr<AsyncSink> sink;
+
+QtMessageHandler previousHandler = nullptr;
+
+
+void
+asyncHandler(QtMsgType type,
+             QMessageLogContext const& context,
+             QString const& message)
+{
+  QString const formatted = qFormatLogMessage(type, context, message);
+
+  if (type == QtFatalMsg)
+  {
+    bool queued = false;
+
+    {
+      std::lock_guard<std::mutex> lock(sinkMutex);
+
+      if (sink && !sink->isWorkerThread())
+      {
+        sink->post(formatted);
+        queued = true;
+      }
+    }
+
+    // the process aborts when the handler returns; removing the sink
+    // writes everything queued, the fatal message last
+    if (queued)
+    {
+      Logging::removeAsyncSink();
+      return;
+    }
+
+    std::fprintf(stderr, "%s\n", formatted.toLocal8Bit().constData());
+    std::fflush(stderr);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(sinkMutex);
+
+  if (sink)
+    sink->post(formatted);
+}
+}
+
+bool
+Logging::
+installAsyncSink(QString const& fileName)
+{
+  std::unique_ptr<AsyncSink> newSink(new AsyncSink(fileName));
+
+  if (!newSink->start())
+    return false;
+
+  {
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    if (!sink)
+      previousHandler = qInstallMessageHandler(asyncHandler);
+
+    // the old sink is drained once the lock is released
+    std::swap(sink, newSink);
+  }
+
+  return true;
+}
+
+
+void
+Logging::
+removeAsyncSink()
+{
+  std::unique_ptr<AsyncSink> oldSink;
+
+  {
+    std::lock_guard<std::mutex> lock(sinkMutex);
+
+    if (!sink)
+      return;
+
+    qInstallMessageHandler(previousHandler);
+
+    oldSink = std::move(sink);
+  }
+}
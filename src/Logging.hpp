@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QString>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Creation and destruction of nodes, connections and their
+/// graphics objects ("qtnodes.lifetime"). Off by default, enable with
+/// QT_LOGGING_RULES="qtnodes.lifetime.debug=true".
+NODE_EDITOR_PUBLIC
+QLoggingCategory const &
+lifetimeLog();
+
+
+class NODE_EDITOR_PUBLIC Logging
+{
+public:
+
+  /// Routes all Qt messages through a background thread that appends
+  /// them to `fileName`, or to stderr if it is empty. Logging threads
+  /// only queue the formatted message. Replaces a previous async sink.
+  static
+  bool
+  installAsyncSink(QString const& fileName = QString());
+
+  /// Writes the queued messages and restores the previous handler
+  static
+  void
+  removeAsyncSink();
+
+private:
+
+  Logging() = delete;
+};
+}
+
+/// Debug message in `category`; compiled out together with qDebug()
+/// in release builds (QT_NO_DEBUG) or with QT_NO_DEBUG_OUTPUT.
+#if defined(QT_NO_DEBUG) || defined(QT_NO_DEBUG_OUTPUT)
+#define NODE_EDITOR_DEBUG(category) QT_NO_QDEBUG_MACRO()
+#else
+#define NODE_EDITOR_DEBUG(category) qCDebug(category)
+#endif
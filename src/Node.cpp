@@ -1,16 +1,21 @@
 #include "Node.hpp"
 
-#include <QtCore/QObject>
+#include <cmath>
+#include <algorithm>
 
-#include <iostream>
+#include <QtCore/QObject>
+#include <QtWidgets/QGraphicsItem>
 
 #include "FlowScene.hpp"
 
 #include "NodeGraphicsObject.hpp"
 #include "NodeDataModel.hpp"
+#include "NodeGroupModel.hpp"
 
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionState.hpp"
+#include "Logging.hpp"
+#include "Trace.hpp"
 
 using QtNodes::Node;
 using QtNodes::NodeGeometry;
@@ -19,15 +24,95 @@ using QtNodes::NodeData;
 using QtNodes::NodeDataType;
 using QtNodes::NodeDataModel;
 using QtNodes::NodeGraphicsObject;
+using QtNodes::NodePortTable;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
+using QtNodes::lifetimeLog;
+using QtNodes::ProfileScope;
+using QtNodes::NodeMemoryUsage;
+
+namespace
+{
+
+void
+trackData(std::vector<std::weak_ptr<NodeData> > &ports,
+          PortIndex index,
+          std::shared_ptr<NodeData> const &data)
+{
+  if (index < 0)
+    return;
+
+  if (ports.size() <= static_cast<std::size_t>(index))
+    ports.resize(index + 1);
+
+  ports[index] = data;
+}
+
+
+std::size_t
+heldBytes(std::vector<std::weak_ptr<NodeData> > const &ports,
+          std::unordered_set<NodeData const*> &counted)
+{
+  std::size_t bytes = 0;
+
+  for (auto const &weak : ports)
+  {
+    auto data = weak.lock();
+
+    if (data && counted.insert(data.get()).second)
+      bytes += data->byteSize();
+  }
+
+  return bytes;
+}
+
+
+/// 32-bit pixmaps of the item and its children at scale 1
+std::size_t
+itemCacheBytes(QGraphicsItem const &item)
+{
+  std::size_t bytes = 0;
+
+  if (item.cacheMode() != QGraphicsItem::NoCache)
+  {
+    QSizeF const size = item.boundingRect().size();
+
+    bytes += static_cast<std::size_t>(std::ceil(size.width()) *
+                                      std::ceil(size.height())) * 4;
+  }
+
+  for (QGraphicsItem const* child : item.childItems())
+    bytes += itemCacheBytes(*child);
+
+  return bytes;
+}
+
+
+/// Frees the cached pixmaps; the items keep their cache mode and
+/// repaint into a new cache when next shown
+void
+dropItemCaches(QGraphicsItem &item)
+{
+  QGraphicsItem::CacheMode const mode = item.cacheMode();
+
+  if (mode != QGraphicsItem::NoCache)
+  {
+    item.setCacheMode(QGraphicsItem::NoCache);
+    item.setCacheMode(mode);
+  }
+
+  for (QGraphicsItem* child : item.childItems())
+    dropItemCaches(*child);
+}
+}
 
 Node::
 Node(std::unique_ptr<NodeDataModel> && dataModel)
   : _id(QUuid::createUuid())
   , _nodeDataModel(std::move(dataModel))
+  , _portTable(*_nodeDataModel)
   , _nodeState(_nodeDataModel)
-  , _nodeGeometry(_nodeDataModel)
+  , _nodeGeometry(_nodeDataModel, _portTable)
   , _nodeGraphicsObject(nullptr)
 {
   _nodeGeometry.recalculateSize();
@@ -35,13 +120,26 @@ Node(std::unique_ptr<NodeDataModel> && dataModel)
   // propagate data: model => node
   connect(_nodeDataModel.get(), &NodeDataModel::dataUpdated,
           this, &Node::onDataUpdated);
+
+  connect(_nodeDataModel.get(), &NodeDataModel::portsChanged,
+          this, &Node::onPortsChanged);
+
+  connect(_nodeDataModel.get(), &NodeDataModel::portsInserted,
+          this, &Node::onPortsInserted);
+
+  connect(_nodeDataModel.get(), &NodeDataModel::portsDeleted,
+          this, &Node::onPortsDeleted);
 }
 
 
 Node::
 ~Node()
 {
-  std::cout << "Node destructor" << std::endl;
+  // a collapsed node holds its model's widget, see FlowScene::collapseNodes()
+  if (_group)
+    delete _nodeDataModel->embeddedWidget();
+
+  NODE_EDITOR_DEBUG(lifetimeLog) << "Node destructor" << _id;
 }
 
 
@@ -55,9 +153,11 @@ save() const
 
   nodeJson["model"] = _nodeDataModel->save();
 
+  QPointF const pos = position();
+
   QJsonObject obj;
-  obj["x"] = _nodeGraphicsObject->pos().x();
-  obj["y"] = _nodeGraphicsObject->pos().y();
+  obj["x"] = pos.x();
+  obj["y"] = pos.y();
   nodeJson["position"] = obj;
 
   return nodeJson;
@@ -137,12 +237,84 @@ void
 Node::
 setGraphicsObject(std::unique_ptr<NodeGraphicsObject>&& graphics)
 {
+  if (_nodeGraphicsObject && !graphics)
+    _position = _nodeGraphicsObject->pos();
+
   _nodeGraphicsObject = std::move(graphics);
 
   _nodeGeometry.recalculateSize();
 }
 
 
+bool
+Node::
+isGroup() const
+{
+  return dynamic_cast<NodeGroupModel const*>(_nodeDataModel.get()) != nullptr;
+}
+
+
+QPointF
+Node::
+position() const
+{
+  if (_nodeGraphicsObject)
+    return _nodeGraphicsObject->pos();
+
+  if (_group)
+  {
+    auto groupModel = static_cast<NodeGroupModel const*>(_group->nodeDataModel());
+
+    return _position + _group->position() - groupModel->origin();
+  }
+
+  return _position;
+}
+
+
+void
+Node::
+setPosition(QPointF const& position)
+{
+  if (_nodeGraphicsObject)
+  {
+    _nodeGraphicsObject->setPos(position);
+  }
+  else if (_group)
+  {
+    auto groupModel = static_cast<NodeGroupModel const*>(_group->nodeDataModel());
+
+    _position = position - _group->position() + groupModel->origin();
+  }
+  else
+  {
+    _position = position;
+  }
+}
+
+
+QPointF
+Node::
+portScenePosition(PortType portType, PortIndex portIndex) const
+{
+  if (_group)
+  {
+    auto groupModel = static_cast<NodeGroupModel const*>(_group->nodeDataModel());
+
+    PortIndex const groupPort = groupModel->groupPort(*this, portType, portIndex);
+
+    if (groupPort != INVALID)
+      return _group->portScenePosition(portType, groupPort);
+
+    return _group->nodeGraphicsObject().sceneBoundingRect().center();
+  }
+
+  return _nodeGeometry.portScenePosition(portIndex,
+                                         portType,
+                                         _nodeGraphicsObject->sceneTransform());
+}
+
+
 NodeGeometry&
 Node::
 nodeGeometry()
@@ -183,18 +355,74 @@ nodeDataModel() const
 }
 
 
+NodePortTable const &
+Node::
+portTable() const
+{
+  return _portTable;
+}
+
+
+NodeMemoryUsage
+Node::
+memoryUsage(std::unordered_set<NodeData const*>* counted) const
+{
+  std::unordered_set<NodeData const*> local;
+
+  if (!counted)
+    counted = &local;
+
+  NodeMemoryUsage usage;
+
+  usage.inputBytes  = heldBytes(_inData, *counted);
+  usage.outputBytes = heldBytes(_outData, *counted);
+  usage.modelBytes  = _nodeDataModel->memoryUsage();
+
+  if (_nodeGraphicsObject)
+    usage.graphicsBytes = itemCacheBytes(*_nodeGraphicsObject);
+
+  return usage;
+}
+
+
+void
+Node::
+releaseGraphicsCaches()
+{
+  if (_nodeGraphicsObject)
+    dropItemCaches(*_nodeGraphicsObject);
+}
+
+
 void
 Node::
 propagateData(std::shared_ptr<NodeData> nodeData,
-              PortIndex inPortIndex) const
+              PortIndex inPortIndex)
 {
-  _nodeDataModel->setInData(nodeData, inPortIndex);
+  NODE_EDITOR_TRACE_SCOPE("propagation", "Node::propagateData");
 
-  //Recalculate the nodes visuals. A data change can result in the node taking more space than before, so this forces a recalculate+repaint on the affected node
-  _nodeGraphicsObject->setGeometryChanged();
-  _nodeGeometry.recalculateSize();
-  _nodeGraphicsObject->update();
-  _nodeGraphicsObject->moveConnections();
+  {
+    ProfileScope scope(_profilingEnabled ? &_profile : nullptr);
+
+    ++_receivingData;
+
+    _nodeDataModel->setInData(nodeData, inPortIndex);
+
+    --_receivingData;
+  }
+
+  trackData(_inData, inPortIndex, nodeData);
+
+  // A data change can alter the caption, the validation message or the
+  // widget size; the node is re-laid out only if one of them did change
+  if (_nodeGraphicsObject)
+  {
+    _nodeGraphicsObject->relayout();
+
+    // painter delegates draw model data and the profiling heatmap the
+    // timings just recorded, repaint even if nothing moved
+    _nodeGraphicsObject->update();
+  }
 }
 
 
@@ -202,11 +430,100 @@ void
 Node::
 onDataUpdated(PortIndex index)
 {
+  NODE_EDITOR_TRACE_SCOPE("propagation", "Node::onDataUpdated");
+
   auto nodeData = _nodeDataModel->outData(index);
 
+  trackData(_outData, index, nodeData);
+
   auto connections =
     _nodeState.connections(PortType::Out, index);
 
   for (auto const & c : connections)
     c.second->propagateData(nodeData);
 }
+
+
+void
+Node::
+onPortsChanged()
+{
+  // port counts change only through portsInserted / portsDeleted
+  Q_ASSERT(_nodeDataModel->nPorts(PortType::In) ==
+           _nodeState.getEntries(PortType::In).size());
+  Q_ASSERT(_nodeDataModel->nPorts(PortType::Out) ==
+           _nodeState.getEntries(PortType::Out).size());
+
+  updatePortLayout();
+}
+
+
+void
+Node::
+onPortsInserted(PortType portType, PortIndex first, PortIndex last)
+{
+  _nodeState.insertPorts(portType, first, last - first + 1);
+
+  auto &tracked = trackedData(portType);
+
+  if (tracked.size() > static_cast<std::size_t>(first))
+    tracked.insert(tracked.begin() + first, last - first + 1,
+                   std::weak_ptr<NodeData>());
+
+  reindexConnections(portType, last + 1);
+
+  updatePortLayout();
+}
+
+
+void
+Node::
+onPortsDeleted(PortType portType, PortIndex first, PortIndex last)
+{
+  _nodeState.erasePorts(portType, first, last - first + 1);
+
+  auto &tracked = trackedData(portType);
+
+  if (tracked.size() > static_cast<std::size_t>(first))
+    tracked.erase(tracked.begin() + first,
+                  tracked.begin() + std::min<std::size_t>(tracked.size(), last + 1));
+
+  reindexConnections(portType, first);
+
+  updatePortLayout();
+}
+
+
+void
+Node::
+reindexConnections(PortType portType, PortIndex first)
+{
+  auto const &entries = _nodeState.getEntries(portType);
+
+  for (PortIndex i = first; i < static_cast<PortIndex>(entries.size()); ++i)
+  {
+    for (auto const &pair : entries[i])
+      pair.second->setPortIndex(portType, i);
+  }
+}
+
+
+void
+Node::
+updatePortLayout()
+{
+  _portTable.rebuild(*_nodeDataModel);
+
+  _nodeGeometry.invalidate(NodeGeometry::PortLayoutChange);
+
+  if (_nodeGraphicsObject)
+    _nodeGraphicsObject->relayout();
+}
+
+
+std::vector<std::weak_ptr<NodeData> > &
+Node::
+trackedData(PortType portType)
+{
+  return portType == PortType::In ? _inData : _outData;
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <memory>
+#include <vector>
+#include <unordered_set>
 
 #include <QtCore/QObject>
 #include <QtCore/QUuid>
+#include <QtCore/QPointF>
 
 #include <QtCore/QJsonObject>
 
@@ -13,6 +16,9 @@
 #include "NodeState.hpp"
 #include "NodeGeometry.hpp"
 #include "NodeData.hpp"
+#include "NodePortTable.hpp"
+#include "NodeProfile.hpp"
+#include "NodeMemoryUsage.hpp"
 #include "NodeGraphicsObject.hpp"
 #include "ConnectionGraphicsObject.hpp"
 #include "Serializable.hpp"
@@ -86,18 +92,110 @@ public:
   NodeDataModel*
   nodeDataModel() const;
 
+  /// Cached port layout of the model
+  NodePortTable const &
+  portTable() const;
+
+  /// True while the model processes data arriving on an input,
+  /// i.e. changes of the model are caused by propagation
+  bool
+  isReceivingData() const { return _receivingData > 0; }
+
+public: // grouping
+
+  /// Group node this node is collapsed into, nullptr if it is visible.
+  /// Collapsed nodes have no graphics object.
+  Node*
+  group() const { return _group; }
+
+  /// Set by FlowScene when collapsing and expanding groups
+  void
+  setGroup(Node* group) { _group = group; }
+
+  /// True for the node standing in for a collapsed group
+  bool
+  isGroup() const;
+
+  /// Scene position of the node, also while collapsed
+  QPointF
+  position() const;
+
+  void
+  setPosition(QPointF const& position);
+
+  /// Scene point where connections attach to the port;
+  /// the matching group port while the node is collapsed
+  QPointF
+  portScenePosition(PortType portType, PortIndex portIndex) const;
+
+public: // profiling
+
+  NodeProfile const &
+  profile() const { return _profile; }
+
+  void
+  resetProfile() { _profile = NodeProfile(); }
+
+  bool
+  isProfilingEnabled() const { return _profilingEnabled; }
+
+  /// Enables timing of the model's setInData calls
+  void
+  setProfilingEnabled(bool enabled) { _profilingEnabled = enabled; }
+
+public: // memory accounting
+
+  /// Bytes held by the data last seen on the node's ports, by its
+  /// model and by the item caches of its graphics objects.
+  /// Payloads already in `counted` are skipped and new ones added,
+  /// so data shared between nodes is counted once across calls.
+  NodeMemoryUsage
+  memoryUsage(std::unordered_set<NodeData const*>* counted = nullptr) const;
+
+  /// Drops the item cache pixmaps of the node's graphics objects
+  void
+  releaseGraphicsCaches();
+
 public slots: // data propagation
 
   /// Propagates incoming data to the underlying model.
   void
   propagateData(std::shared_ptr<NodeData> nodeData,
-                PortIndex inPortIndex) const;
+                PortIndex inPortIndex);
 
   /// Fetches data from model's OUT #index port
   /// and propagates it to the connection
   void
   onDataUpdated(PortIndex index);
 
+  /// Rebuilds the cached port table after the model
+  /// has changed its port layout
+  void
+  onPortsChanged();
+
+  /// Grows NodeState in place and shifts the connections
+  /// attached behind the inserted ports
+  void
+  onPortsInserted(PortType portType, PortIndex first, PortIndex last);
+
+  /// Shrinks NodeState in place. Connections of the removed ports
+  /// must already be deleted (FlowScene does it on portsAboutToBeDeleted)
+  void
+  onPortsDeleted(PortType portType, PortIndex first, PortIndex last);
+
+private:
+
+  /// Assigns the current entry index to every connection
+  /// on the given side, starting from `first`
+  void
+  reindexConnections(PortType portType, PortIndex first);
+
+  void
+  updatePortLayout();
+
+  std::vector<std::weak_ptr<NodeData> > &
+  trackedData(PortType portType);
+
 private:
 
   // addressing
@@ -108,8 +206,27 @@ private:
 
   std::unique_ptr<NodeDataModel> _nodeDataModel;
 
+  NodePortTable _portTable;
+
   NodeState _nodeState;
 
+  mutable NodeProfile _profile;
+
+  bool _profilingEnabled = false;
+
+  mutable int _receivingData = 0;
+
+  Node* _group = nullptr;
+
+  /// Position kept while there is no graphics object, relative
+  /// to the group's origin while collapsed
+  QPointF _position;
+
+  /// Data last seen on each port, for memory accounting only;
+  /// weak, so the node never keeps a payload alive
+  std::vector<std::weak_ptr<NodeData> > _inData;
+  std::vector<std::weak_ptr<NodeData> > _outData;
+
   // painting
 
   NodeGeometry _nodeGeometry;
@@ -13,6 +13,7 @@ using QtNodes::FlowScene;
 using QtNodes::Node;
 using QtNodes::Connection;
 using QtNodes::NodeDataModel;
+using QtNodes::TypeId;
 
 
 NodeConnectionInteraction::
@@ -38,6 +39,12 @@ canConnect(PortIndex &portIndex, bool& typeConversionNeeded, std::unique_ptr<Nod
     return false;
   }
 
+  // group ports only show the connections of the inner nodes
+  if (_node->isGroup())
+  {
+    return false;
+  }
+
   // 2) connection point is on top of the node port
 
   QPointF connectionPoint = connectionEndScenePosition(requiredPort);
@@ -53,24 +60,23 @@ canConnect(PortIndex &portIndex, bool& typeConversionNeeded, std::unique_ptr<Nod
   // 3) Node port is vacant
 
   // port should be empty --depending on the policy
-  auto nodePolicy = _node->nodeDataModel()->nodeConnectionPolicy(requiredPort, portIndex);
+  auto nodePolicy = _node->portTable().port(requiredPort, portIndex).connectionPolicy;
   if (nodePolicy == NodeDataModel::One && !nodePortIsEmpty(requiredPort, portIndex))
     return false;
 
   // 4) Connection type equals node port type, or there is a registered type conversion that can translate between the two
 
-  auto connectionDataType = _connection->dataType();
+  TypeId const connectionTypeId = _connection->typeId();
 
-  auto const   &modelTarget = _node->nodeDataModel();
-  NodeDataType candidateNodeDataType = modelTarget->dataType(requiredPort, portIndex);
+  TypeId const candidateTypeId = _node->portTable().port(requiredPort, portIndex).typeId;
 
-  if (connectionDataType.id != candidateNodeDataType.id)
+  if (connectionTypeId != candidateTypeId)
   {
     if (requiredPort == PortType::In)
     {
-      return typeConversionNeeded = (converterModel = _scene->registry().getTypeConverter(connectionDataType.id, candidateNodeDataType.id)) != nullptr;
+      return typeConversionNeeded = (converterModel = _scene->registry().getTypeConverter(connectionTypeId, candidateTypeId)) != nullptr;
     }
-    return typeConversionNeeded = (converterModel = _scene->registry().getTypeConverter(candidateNodeDataType.id, connectionDataType.id)) != nullptr;
+    return typeConversionNeeded = (converterModel = _scene->registry().getTypeConverter(candidateTypeId, connectionTypeId)) != nullptr;
   }
 
   return true;
@@ -251,7 +257,7 @@ nodePortIsEmpty(PortType portType, PortIndex portIndex) const
 
   auto const & entries = nodeState.getEntries(portType);
 
-  auto ncp = _node->nodeDataModel()->nodeConnectionPolicy(portType, portIndex);
+  auto ncp = _node->portTable().port(portType, portIndex).connectionPolicy;
   return (ncp == NodeDataModel::Many) ||
          (entries[portIndex].empty());
 }
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+
 #include <QtCore/QString>
 
+class QIODevice;
+
 #include "Export.hpp"
+#include "NodeDataTypeRegistry.hpp"
 
 namespace QtNodes
 {
@@ -20,14 +26,54 @@ class NODE_EDITOR_PUBLIC NodeData
 {
 public:
 
+  NodeData() = default;
+
+  // the cached id belongs to the object, a copy looks it up again
+  NodeData(NodeData const &) {}
+
+  NodeData &
+  operator=(NodeData const &) { return *this; }
+
   virtual ~NodeData() = default;
 
   virtual bool sameType(NodeData const &nodeData) const
   {
-    return (this->type().id == nodeData.type().id);
+    return typeId() == nodeData.typeId();
   }
 
-  /// Type for inner use
+  /// Type for inner use. Must not change during the object's lifetime.
   virtual NodeDataType type() const = 0;
+
+  /// Interned type().id, looked up once per object
+  TypeId
+  typeId() const
+  {
+    TypeId id = _typeId.load(std::memory_order_relaxed);
+
+    if (id == INVALID_TYPE_ID)
+    {
+      id = NodeDataTypeRegistry::intern(type().id);
+
+      _typeId.store(id, std::memory_order_relaxed);
+    }
+
+    return id;
+  }
+
+  /// Approximate memory held by the payload, 0 if unknown.
+  /// Used for memory accounting only.
+  virtual std::size_t byteSize() const { return 0; }
+
+  /// Writes the payload to `device` and frees its memory in place,
+  /// see RetainedData. Returns false if the payload can't be spilled,
+  /// also when its memory is implicitly shared with other objects.
+  virtual bool spillPayload(QIODevice &/*device*/) { return false; }
+
+  /// Reads back exactly what spillPayload() wrote
+  virtual bool restorePayload(QIODevice &/*device*/) { return false; }
+
+private:
+
+  mutable std::atomic<TypeId> _typeId{ INVALID_TYPE_ID };
 };
 }
@@ -140,6 +140,18 @@ public:
   virtual
   NodePainterDelegate* painterDelegate() const { return  nullptr; }
 
+  /// Bytes held by the model besides the data on its ports,
+  /// e.g. lookup tables or the contents of the embedded widget
+  virtual
+  std::size_t
+  memoryUsage() const { return 0; }
+
+  /// Drops data the model can recompute on demand. Called when the
+  /// scene exceeds its memory budget; returns the bytes released.
+  virtual
+  std::size_t
+  releaseCachedData() { return 0; }
+
 signals:
 
   void
@@ -154,6 +166,25 @@ signals:
   void
   computingFinished();
 
+  /// Emitted after port types, captions or policies have changed.
+  /// The node re-reads its cached port table in response.
+  void
+  portsChanged();
+
+  /// Emitted after the model has inserted ports [first, last]
+  /// of the given side. Existing connections are shifted, not rebuilt.
+  void
+  portsInserted(PortType portType, PortIndex first, PortIndex last);
+
+  /// Emitted while ports [first, last] still exist.
+  /// Connections attached to them are deleted in response.
+  void
+  portsAboutToBeDeleted(PortType portType, PortIndex first, PortIndex last);
+
+  /// Emitted after the model has removed ports [first, last]
+  void
+  portsDeleted(PortType portType, PortIndex first, PortIndex last);
+
 private:
 
   NodeStyle _nodeStyle;
@@ -0,0 +1,96 @@
+#include "NodeDataTypeRegistry.hpp"
+
+#include <vector>
+#include <unordered_map>
+
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QReadLocker>
+#include <QtCore/QWriteLocker>
+
+#include "QStringStdHash.hpp"
+
+using QtNodes::NodeDataTypeRegistry;
+using QtNodes::TypeId;
+
+namespace
+{
+
+struct TypeTable
+{
+  QReadWriteLock lock;
+
+  std::unordered_map<QString, TypeId> ids;
+
+  // index 0 is reserved for INVALID_TYPE_ID
+  std::vector<QString> strings{ QString() };
+};
+
+
+TypeTable &
+typeTable()
+{
+  static TypeTable table;
+
+  return table;
+}
+}
+
+TypeId
+NodeDataTypeRegistry::
+intern(QString const &typeId)
+{
+  if (typeId.isEmpty())
+    return INVALID_TYPE_ID;
+
+  auto &table = typeTable();
+
+  {
+    QReadLocker locker(&table.lock);
+
+    auto it = table.ids.find(typeId);
+
+    if (it != table.ids.end())
+      return it->second;
+  }
+
+  QWriteLocker locker(&table.lock);
+
+  auto it = table.ids.find(typeId);
+
+  if (it != table.ids.end())
+    return it->second;
+
+  TypeId const id = static_cast<TypeId>(table.strings.size());
+
+  table.strings.push_back(typeId);
+  table.ids[typeId] = id;
+
+  return id;
+}
+
+
+QString
+NodeDataTypeRegistry::
+typeIdString(TypeId id)
+{
+  auto &table = typeTable();
+
+  QReadLocker locker(&table.lock);
+
+  if (id < table.strings.size())
+    return table.strings[id];
+
+  return QString();
+}
+
+
+std::size_t
+NodeDataTypeRegistry::
+count()
+{
+  auto &table = typeTable();
+
+  QReadLocker locker(&table.lock);
+
+  return table.strings.size() - 1;
+}
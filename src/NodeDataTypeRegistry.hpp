@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include <QtCore/QString>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Small integer standing for an interned NodeDataType::id
+using TypeId = unsigned int;
+
+static const TypeId INVALID_TYPE_ID = 0;
+
+/// Process-wide table mapping NodeDataType ids to small integers.
+/// Interning happens once per port (see NodePortTable); afterwards type
+/// comparisons, converter lookups and color lookups are integer operations.
+class NODE_EDITOR_PUBLIC NodeDataTypeRegistry
+{
+public:
+
+  /// Returns the id for `typeId`, registering it on first use.
+  /// An empty string maps to INVALID_TYPE_ID.
+  static
+  TypeId
+  intern(QString const &typeId);
+
+  /// Returns the string an id was interned from
+  static
+  QString
+  typeIdString(TypeId id);
+
+  /// Number of interned types, ids are in [1, count()]
+  static
+  std::size_t
+  count();
+
+private:
+
+  NodeDataTypeRegistry() = delete;
+};
+
+struct TypeIdPairHash
+{
+  std::size_t
+  operator()(std::pair<TypeId, TypeId> const &p) const
+  {
+    return std::hash<unsigned long long>()(
+      (static_cast<unsigned long long>(p.first) << 32) | p.second);
+  }
+};
+}
@@ -6,19 +6,25 @@
 #include "PortType.hpp"
 #include "NodeState.hpp"
 #include "NodeDataModel.hpp"
+#include "NodePortTable.hpp"
+#include "TextMetricsCache.hpp"
 #include "Node.hpp"
 #include "NodeGraphicsObject.hpp"
 
 #include "StyleCollection.hpp"
+#include "RenderStatistics.hpp"
+#include "Trace.hpp"
 
 using QtNodes::NodeGeometry;
 using QtNodes::NodeDataModel;
 using QtNodes::PortIndex;
 using QtNodes::PortType;
 using QtNodes::Node;
+using QtNodes::RenderCounters;
 
 NodeGeometry::
-NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel)
+NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel,
+             NodePortTable &portTable)
   : _width(100)
   , _height(150)
   , _inputPortWidth(70)
@@ -26,16 +32,33 @@ NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel)
   , _entryHeight(20)
   , _spacing(20)
   , _hovered(false)
-  , _nSources(dataModel->nPorts(PortType::Out))
-  , _nSinks(dataModel->nPorts(PortType::In))
   , _draggingPos(-1000, -1000)
   , _dataModel(dataModel)
-  , _fontMetrics(QFont())
-  , _boldFontMetrics(QFont())
+  , _portTable(portTable)
+  , _invalidation(NoChange)
+  , _captionVisible(true)
+  , _validationState(NodeValidationState::Valid)
+  , _textMetrics(TextMetricsCache::forFont(_font))
 {
-  QFont f; f.setBold(true);
+  QFont f = _font; f.setBold(true);
 
-  _boldFontMetrics = QFontMetrics(f);
+  _boldTextMetrics = TextMetricsCache::forFont(f);
+}
+
+
+unsigned int
+NodeGeometry::
+nSources() const
+{
+  return _portTable.nPorts(PortType::Out);
+}
+
+
+unsigned int
+NodeGeometry::
+nSinks() const
+{
+  return _portTable.nPorts(PortType::In);
 }
 
 
@@ -71,60 +94,170 @@ void
 NodeGeometry::
 recalculateSize() const
 {
-  _entryHeight = _fontMetrics.height();
+  NODE_EDITOR_TRACE_SCOPE("layout", "NodeGeometry::recalculateSize");
 
-  {
-    unsigned int maxNumOfEntries = std::max(_nSinks, _nSources);
-    unsigned int step = _entryHeight + _spacing;
-    _height = step * maxNumOfEntries;
-  }
+  snapshotModel();
 
-  if (auto w = _dataModel->embeddedWidget())
-  {
-    _height = std::max(_height, static_cast<unsigned>(w->height()));
-  }
+  computeLayout(_width, _height);
 
-  _height += captionHeight();
+  ++RenderCounters::totals().layouts;
 
-  _inputPortWidth  = portWidth(PortType::In);
-  _outputPortWidth = portWidth(PortType::Out);
+  _invalidation = NoChange;
+}
 
-  _width = _inputPortWidth +
-           _outputPortWidth +
-           2 * _spacing;
 
-  if (auto w = _dataModel->embeddedWidget())
+void
+NodeGeometry::
+recalculateSize(QFont const & font) const
+{
+  setFont(font);
+
+  if (isDirty())
+    recalculateSize();
+}
+
+
+void
+NodeGeometry::
+setFont(QFont const &font) const
+{
+  if (_font == font)
+    return;
+
+  QFont boldFont = font;
+
+  boldFont.setBold(true);
+
+  _font            = font;
+  _textMetrics     = TextMetricsCache::forFont(font);
+  _boldTextMetrics = TextMetricsCache::forFont(boldFont);
+
+  _portTable.measureLabels(*_textMetrics);
+
+  invalidate(FontChange);
+}
+
+
+void
+NodeGeometry::
+detectModelChanges() const
+{
+  if (_dataModel->captionVisible() != _captionVisible ||
+      (_captionVisible && _dataModel->caption() != _caption))
   {
-    _width += w->width();
+    invalidate(CaptionChange);
   }
 
-  _width = std::max(_width, captionWidth());
+  auto const state = _dataModel->validationState();
 
-  if (_dataModel->validationState() != NodeValidationState::Valid)
+  if (state != _validationState ||
+      (state != NodeValidationState::Valid &&
+       _dataModel->validationMessage() != _validationMessage))
   {
-    _width   = std::max(_width, validationWidth());
-    _height += validationHeight() + _spacing;
+    invalidate(ValidationChange);
+  }
+
+  auto w = _dataModel->embeddedWidget();
+
+  if ((w ? w->size() : QSize()) != _widgetSize)
+  {
+    invalidate(WidgetResize);
   }
 }
 
 
+bool
+NodeGeometry::
+updateLayout(std::function<void()> const &beforeResize) const
+{
+  if (!isDirty())
+    return false;
+
+  snapshotModel();
+
+  unsigned int width  = 0;
+  unsigned int height = 0;
+
+  computeLayout(width, height);
+
+  ++RenderCounters::totals().layouts;
+
+  _invalidation = NoChange;
+
+  if (width == _width && height == _height)
+    return false;
+
+  if (beforeResize)
+    beforeResize();
+
+  _width  = width;
+  _height = height;
+
+  return true;
+}
+
+
 void
 NodeGeometry::
-recalculateSize(QFont const & font) const
+snapshotModel() const
 {
-  QFontMetrics fontMetrics(font);
-  QFont boldFont = font;
+  _captionVisible = _dataModel->captionVisible();
+  _caption        = _captionVisible ? _dataModel->caption() : QString();
 
-  boldFont.setBold(true);
+  _validationState   = _dataModel->validationState();
+  _validationMessage = _validationState != NodeValidationState::Valid
+                       ? _dataModel->validationMessage()
+                       : QString();
 
-  QFontMetrics boldFontMetrics(boldFont);
+  auto w = _dataModel->embeddedWidget();
+
+  _widgetSize = w ? w->size() : QSize();
+}
+
+
+void
+NodeGeometry::
+computeLayout(unsigned int &width, unsigned int &height) const
+{
+  _entryHeight = _textMetrics->height();
+
+  if (!_portTable.labelsMeasured())
+    _portTable.measureLabels(*_textMetrics);
+
+  _captionText    = _boldTextMetrics->staticText(_caption);
+  _validationText = _textMetrics->staticText(_validationMessage);
 
-  if (_boldFontMetrics != boldFontMetrics)
   {
-    _fontMetrics     = fontMetrics;
-    _boldFontMetrics = boldFontMetrics;
+    unsigned int maxNumOfEntries = std::max(nSinks(), nSources());
+    unsigned int step = _entryHeight + _spacing;
+    height = step * maxNumOfEntries;
+  }
 
-    recalculateSize();
+  if (!_widgetSize.isEmpty())
+  {
+    height = std::max(height, static_cast<unsigned>(_widgetSize.height()));
+  }
+
+  height += captionHeight();
+
+  _inputPortWidth  = portWidth(PortType::In);
+  _outputPortWidth = portWidth(PortType::Out);
+
+  width = _inputPortWidth +
+          _outputPortWidth +
+          2 * _spacing;
+
+  if (!_widgetSize.isEmpty())
+  {
+    width += _widgetSize.width();
+  }
+
+  width = std::max(width, captionWidth());
+
+  if (_validationState != NodeValidationState::Valid)
+  {
+    width   = std::max(width, validationWidth());
+    height += validationHeight() + _spacing;
   }
 }
 
@@ -191,7 +324,7 @@ checkHitScenePoint(PortType portType,
 
   double const tolerance = 2.0 * nodeStyle.ConnectionPointDiameter;
 
-  size_t const nItems = _dataModel->nPorts(portType);
+  size_t const nItems = _portTable.nPorts(portType);
 
   for (size_t i = 0; i < nItems; ++i)
   {
@@ -230,7 +363,7 @@ widgetPosition() const
 {
   if (auto w = _dataModel->embeddedWidget())
   {
-    if (_dataModel->validationState() != NodeValidationState::Valid)
+    if (_validationState != NodeValidationState::Valid)
     {
       return QPointF(_spacing + portWidth(PortType::In),
                      (captionHeight() + _height - validationHeight() - _spacing - w->height()) / 2.0);
@@ -248,12 +381,10 @@ unsigned int
 NodeGeometry::
 captionHeight() const
 {
-  if (!_dataModel->captionVisible())
+  if (!_captionVisible)
     return 0;
 
-  QString name = _dataModel->caption();
-
-  return _boldFontMetrics.boundingRect(name).height();
+  return _boldTextMetrics->boundingRect(_caption).height();
 }
 
 
@@ -261,12 +392,10 @@ unsigned int
 NodeGeometry::
 captionWidth() const
 {
-  if (!_dataModel->captionVisible())
+  if (!_captionVisible)
     return 0;
 
-  QString name = _dataModel->caption();
-
-  return _boldFontMetrics.boundingRect(name).width();
+  return _boldTextMetrics->boundingRect(_caption).width();
 }
 
 
@@ -274,9 +403,7 @@ unsigned int
 NodeGeometry::
 validationHeight() const
 {
-  QString msg = _dataModel->validationMessage();
-
-  return _boldFontMetrics.boundingRect(msg).height();
+  return _boldTextMetrics->boundingRect(_validationMessage).height();
 }
 
 
@@ -284,9 +411,7 @@ unsigned int
 NodeGeometry::
 validationWidth() const
 {
-  QString msg = _dataModel->validationMessage();
-
-  return _boldFontMetrics.boundingRect(msg).width();
+  return _boldTextMetrics->boundingRect(_validationMessage).width();
 }
 
 
@@ -312,24 +437,5 @@ unsigned int
 NodeGeometry::
 portWidth(PortType portType) const
 {
-  unsigned width = 0;
-
-  for (auto i = 0ul; i < _dataModel->nPorts(portType); ++i)
-  {
-    QString name;
-
-    if (_dataModel->portCaptionVisible(portType, i))
-    {
-      name = _dataModel->portCaption(portType, i);
-    }
-    else
-    {
-      name = _dataModel->dataType(portType, i).name;
-    }
-
-    width = std::max(unsigned(_fontMetrics.width(name)),
-                     width);
-  }
-
-  return width;
+  return _portTable.maxLabelWidth(portType);
 }
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <functional>
 
 #include <QtCore/QRectF>
 #include <QtCore/QPointF>
+#include <QtCore/QSize>
+#include <QtCore/QString>
 #include <QtGui/QTransform>
-#include <QtGui/QFontMetrics>
+#include <QtGui/QFont>
+#include <QtGui/QStaticText>
 
 #include "PortType.hpp"
 #include "Export.hpp"
@@ -15,13 +19,29 @@ namespace QtNodes
 
 class NodeState;
 class NodeDataModel;
+class NodePortTable;
+class TextMetrics;
 class Node;
 
+enum class NodeValidationState;
+
 class NODE_EDITOR_PUBLIC NodeGeometry
 {
 public:
 
-  NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel);
+  /// Reasons for the cached layout to become stale
+  enum InvalidationCause
+  {
+    NoChange         = 0x00,
+    FontChange       = 0x01,
+    CaptionChange    = 0x02,
+    ValidationChange = 0x04,
+    WidgetResize     = 0x08,
+    PortLayoutChange = 0x10
+  };
+
+  NodeGeometry(std::unique_ptr<NodeDataModel> const &dataModel,
+               NodePortTable &portTable);
 
 public:
   unsigned int
@@ -60,10 +80,10 @@ public:
   setHovered(unsigned int h) { _hovered = h; }
 
   unsigned int
-  nSources() const { return _nSources; }
+  nSources() const;
 
   unsigned int
-  nSinks() const { return _nSinks; }
+  nSinks() const;
 
   QPointF const&
   draggingPos() const
@@ -85,10 +105,54 @@ public:
   void
   recalculateSize() const;
 
-  /// Updates size if the QFontMetrics is changed
+  /// Updates size if the font is changed
   void
   recalculateSize(QFont const &font) const;
 
+  QFont const &
+  font() const { return _font; }
+
+  /// Switches to the metrics of `font`, invalidates on change
+  void
+  setFont(QFont const &font) const;
+
+  void
+  invalidate(unsigned int causes) const { _invalidation |= causes; }
+
+  /// Pending InvalidationCause flags
+  unsigned int
+  invalidation() const { return _invalidation; }
+
+  bool
+  isDirty() const { return _invalidation != NoChange; }
+
+  /// Compares caption, validation state and embedded widget size with
+  /// the values of the last layout and invalidates what has changed
+  void
+  detectModelChanges() const;
+
+  /// Recomputes the layout if it is dirty.
+  /// `beforeResize` is called right before width or height change,
+  /// so the owner can call prepareGeometryChange() only when needed.
+  /// Returns true if the size has changed.
+  bool
+  updateLayout(std::function<void()> const &beforeResize) const;
+
+  /// Shared metrics of the regular and bold node font
+  TextMetrics const &
+  textMetrics() const { return *_textMetrics; }
+
+  TextMetrics const &
+  boldTextMetrics() const { return *_boldTextMetrics; }
+
+  /// Caption laid out in the bold font, updated with the layout
+  QStaticText const &
+  captionText() const { return _captionText; }
+
+  /// Validation message laid out in the regular font
+  QStaticText const &
+  validationText() const { return _validationText; }
+
   // TODO removed default QTransform()
   QPointF
   portScenePosition(PortIndex index,
@@ -129,6 +193,14 @@ private:
   unsigned int
   portWidth(PortType portType) const;
 
+  /// Runs the layout without touching width and height
+  void
+  computeLayout(unsigned int &width, unsigned int &height) const;
+
+  /// Remembers the model values the layout is based on
+  void
+  snapshotModel() const;
+
 private:
 
   // some variables are mutable because
@@ -146,14 +218,27 @@ private:
 
   bool _hovered;
 
-  unsigned int _nSources;
-  unsigned int _nSinks;
-
   QPointF _draggingPos;
 
   std::unique_ptr<NodeDataModel> const &_dataModel;
 
-  mutable QFontMetrics _fontMetrics;
-  mutable QFontMetrics _boldFontMetrics;
+  NodePortTable &_portTable;
+
+  mutable QFont _font;
+
+  mutable unsigned int _invalidation;
+
+  // model values used by the last layout
+  mutable QString             _caption;
+  mutable bool                _captionVisible;
+  mutable NodeValidationState _validationState;
+  mutable QString             _validationMessage;
+  mutable QSize               _widgetSize;
+
+  mutable QStaticText _captionText;
+  mutable QStaticText _validationText;
+
+  mutable std::shared_ptr<TextMetrics> _textMetrics;
+  mutable std::shared_ptr<TextMetrics> _boldTextMetrics;
 };
 }
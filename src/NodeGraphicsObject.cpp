@@ -4,7 +4,6 @@
 #include <cstdlib>
 
 #include <QtWidgets/QtWidgets>
-#include <QtWidgets/QGraphicsEffect>
 
 #include "ConnectionGraphicsObject.hpp"
 #include "ConnectionState.hpp"
@@ -14,6 +13,7 @@
 
 #include "Node.hpp"
 #include "NodeDataModel.hpp"
+#include "NodeGroupModel.hpp"
 #include "NodeConnectionInteraction.hpp"
 
 #include "StyleCollection.hpp"
@@ -21,6 +21,8 @@
 using QtNodes::NodeGraphicsObject;
 using QtNodes::Node;
 using QtNodes::FlowScene;
+using QtNodes::Connection;
+using QtNodes::NodeGroupModel;
 
 NodeGraphicsObject::
 NodeGraphicsObject(FlowScene &scene,
@@ -30,41 +32,26 @@ NodeGraphicsObject(FlowScene &scene,
   , _proxyWidget(nullptr)
   , _locked(false)
 {
-  _scene.addItem(this);
-
   setFlag(QGraphicsItem::ItemDoesntPropagateOpacityToChildren, true);
   setFlag(QGraphicsItem::ItemIsMovable, true);
   setFlag(QGraphicsItem::ItemIsFocusable, true);
   setFlag(QGraphicsItem::ItemIsSelectable, true);
   setFlag(QGraphicsItem::ItemSendsScenePositionChanges, true);
 
-  setCacheMode( QGraphicsItem::DeviceCoordinateCache );
+  // the shadow is painted from a shared sprite (see NodeSpriteCache),
+  // so there is no per-item graphics effect and no per-item cache pixmap
 
   auto const &nodeStyle = StyleCollection::nodeStyle();
 
-  {
-    auto effect = new QGraphicsDropShadowEffect;
-    effect->setOffset(4, 4);
-    effect->setBlurRadius(20);
-    effect->setColor(nodeStyle.ShadowColor);
-
-    setGraphicsEffect(effect);
-  }
-
   setOpacity(nodeStyle.Opacity);
 
   setAcceptHoverEvents(true);
 
   setZValue(0);
 
-  embedQWidget();
+  _node.nodeGeometry().setFont(_scene.font());
 
-  // connect to the move signals to emit the move signals in FlowScene
-  auto onMoveSlot = [this] {
-    _scene.nodeMoved(_node, pos());
-  };
-  connect(this, &QGraphicsObject::xChanged, this, onMoveSlot);
-  connect(this, &QGraphicsObject::yChanged, this, onMoveSlot);
+  embedQWidget();
 }
 
 
@@ -131,6 +118,36 @@ setGeometryChanged()
 }
 
 
+void
+NodeGraphicsObject::
+relayout()
+{
+  auto & geom = _node.nodeGeometry();
+
+  geom.detectModelChanges();
+
+  if (!geom.isDirty())
+    return;
+
+  // port positions depend on these even if the size stays the same
+  unsigned int const portCauses = NodeGeometry::FontChange |
+                                  NodeGeometry::CaptionChange |
+                                  NodeGeometry::PortLayoutChange;
+
+  bool const portsMoved = (geom.invalidation() & portCauses) != 0;
+
+  bool const resized = geom.updateLayout([this] { prepareGeometryChange(); });
+
+  if (_proxyWidget)
+    _proxyWidget->setPos(geom.widgetPosition());
+
+  update();
+
+  if (resized || portsMoved)
+    moveConnections();
+}
+
+
 void
 NodeGraphicsObject::
 moveConnections() const
@@ -154,6 +171,29 @@ moveConnections() const
   moveConnections(PortType::In);
 
   moveConnections(PortType::Out);
+
+  // a group node carries the ends of its boundary connections
+  if (auto group = dynamic_cast<NodeGroupModel*>(_node.nodeDataModel()))
+  {
+    for (Connection* connection : group->boundaryConnections())
+      connection->getConnectionGraphicsObject().move();
+  }
+}
+
+
+void
+NodeGraphicsObject::
+releaseEmbeddedWidget()
+{
+  if (!_proxyWidget)
+    return;
+
+  QWidget* w = _proxyWidget->widget();
+
+  _proxyWidget->setWidget(nullptr);
+
+  if (w)
+    w->hide();
 }
 
 void NodeGraphicsObject::lock(bool locked)
@@ -181,9 +221,14 @@ QVariant
 NodeGraphicsObject::
 itemChange(GraphicsItemChange change, const QVariant &value)
 {
-  if (change == ItemPositionChange && scene())
+  // one notification per position change; group moves done by
+  // FlowScene::moveNodes update connections and signal in bulk
+  if (change == ItemScenePositionHasChanged && scene() &&
+      !_scene.isMovingNodes())
   {
     moveConnections();
+
+    _scene.nodeMoved(_node, pos());
   }
 
   return QGraphicsItem::itemChange(change, value);
@@ -221,7 +266,7 @@ mousePressEvent(QGraphicsSceneMouseEvent * event)
           nodeState.connections(portToCheck, portIndex);
 
         // start dragging existing connection
-      auto ncp = _node.nodeDataModel()->nodeConnectionPolicy(portToCheck, portIndex);
+      auto ncp = _node.portTable().port(portToCheck, portIndex).connectionPolicy;
       if (!connections.empty() && ncp == NodeDataModel::One)
         {
           auto con = connections.begin()->second;
@@ -247,8 +292,12 @@ mousePressEvent(QGraphicsSceneMouseEvent * event)
       }
     };
 
-  clickPort(PortType::In);
-  clickPort(PortType::Out);
+  // connections of a group belong to its inner nodes
+  if (!_node.isGroup())
+  {
+    clickPort(PortType::In);
+    clickPort(PortType::Out);
+  }
 
   auto pos     = event->pos();
   auto & geom  = _node.nodeGeometry();
@@ -275,8 +324,6 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
 
     if (auto w = _node.nodeDataModel()->embeddedWidget())
     {
-      prepareGeometryChange();
-
       auto oldSize = w->size();
 
       oldSize += QSize(diff.x(), diff.y());
@@ -285,31 +332,47 @@ mouseMoveEvent(QGraphicsSceneMouseEvent * event)
 
       _proxyWidget->setMinimumSize(oldSize);
       _proxyWidget->setMaximumSize(oldSize);
-      _proxyWidget->setPos(geom.widgetPosition());
 
-      geom.recalculateSize();
-      update();
+      geom.invalidate(NodeGeometry::WidgetResize);
 
-      moveConnections();
+      relayout();
 
       event->accept();
     }
+
+    scene()->setSceneRect(scene()->sceneRect().united(sceneBoundingRect()));
   }
-  else
+  else if ((event->buttons() & Qt::LeftButton) &&
+           (flags() & ItemIsMovable))
   {
-    QGraphicsObject::mouseMoveEvent(event);
+    // the whole selection moves together, like QGraphicsItem does,
+    // but with a single pass over the attached connections
+    std::vector<Node*> nodes;
+
+    if (isSelected())
+    {
+      for (Node* node : _scene.selectedNodes())
+      {
+        if (node->nodeGraphicsObject().flags() & ItemIsMovable)
+          nodes.push_back(node);
+      }
+    }
+    else
+    {
+      nodes.push_back(&_node);
+    }
 
-    if (event->lastPos() != event->pos())
-      moveConnections();
+    _scene.moveNodes(nodes, event->scenePos() - event->lastScenePos());
 
-    event->ignore();
-  }
+    QRectF r = scene()->sceneRect();
 
-  QRectF r = scene()->sceneRect();
+    for (Node* node : nodes)
+      r |= node->nodeGraphicsObject().sceneBoundingRect();
 
-  r = r.united(mapToScene(boundingRect()).boundingRect());
+    scene()->setSceneRect(r);
 
-  scene()->setSceneRect(r);
+    event->ignore();
+  }
 }
 
 
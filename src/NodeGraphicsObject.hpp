@@ -42,11 +42,22 @@ public:
   void
   setGeometryChanged();
 
+  /// Re-runs the node layout if the geometry was invalidated or the
+  /// model's caption, validation state or widget size has changed.
+  /// prepareGeometryChange() is called only if the size changes.
+  void
+  relayout();
+
   /// Visits all attached connections and corrects
   /// their corresponding end points.
   void
   moveConnections() const;
 
+  /// Takes the model's widget out of the item, so that it survives
+  /// the destruction of this object. The widget is hidden.
+  void
+  releaseEmbeddedWidget();
+
   enum { Type = UserType + 1 };
 
   int
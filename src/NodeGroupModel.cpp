@@ -0,0 +1,267 @@
+#include "NodeGroupModel.hpp"
+
+#include <unordered_set>
+
+#include "Node.hpp"
+#include "Connection.hpp"
+
+using QtNodes::NodeGroupModel;
+using QtNodes::NodeDataModel;
+using QtNodes::NodeDataType;
+using QtNodes::Node;
+using QtNodes::Connection;
+using QtNodes::PortType;
+using QtNodes::PortIndex;
+
+NodeGroupModel::
+NodeGroupModel(std::vector<Node*> nodes, QPointF const& origin)
+  : _nodes(std::move(nodes))
+  , _origin(origin)
+{
+  _inPorts  = collectPorts(PortType::In);
+  _outPorts = collectPorts(PortType::Out);
+
+  rebuildPortMap();
+
+  // Node's own slots, connected first, have updated the inner
+  // connections by the time these run
+  for (Node* node : _nodes)
+  {
+    NodeDataModel* model = node->nodeDataModel();
+
+    connect(model, &NodeDataModel::portsInserted,
+            this, [this]() { rebuildPorts(); });
+
+    connect(model, &NodeDataModel::portsDeleted,
+            this, [this]() { rebuildPorts(); });
+
+    connect(model, &NodeDataModel::portsChanged,
+            this, &NodeDataModel::portsChanged);
+  }
+}
+
+
+PortIndex
+NodeGroupModel::
+groupPort(Node const& node, PortType portType, PortIndex portIndex) const
+{
+  auto it = _portMap.find(&node);
+
+  if (it == _portMap.end())
+    return INVALID;
+
+  auto const &map = (portType == PortType::In) ? it->second.in
+                                               : it->second.out;
+
+  if (portIndex < 0 || portIndex >= static_cast<PortIndex>(map.size()))
+    return INVALID;
+
+  return map[portIndex];
+}
+
+
+std::vector<Connection*>
+NodeGroupModel::
+boundaryConnections() const
+{
+  std::vector<Connection*> result;
+
+  for (PortType portType : { PortType::In, PortType::Out })
+  {
+    for (Port const &port : ports(portType))
+    {
+      auto const &entries = port.node->nodeState().getEntries(portType);
+
+      if (port.index >= static_cast<PortIndex>(entries.size()))
+        continue;
+
+      for (auto const &pair : entries[port.index])
+      {
+        if (!pair.second->isCollapsed())
+          result.push_back(pair.second);
+      }
+    }
+  }
+
+  return result;
+}
+
+
+bool
+NodeGroupModel::
+isCurrent(Port const& port)
+{
+  return port.index >= 0 &&
+         static_cast<unsigned int>(port.index) <
+         port.node->nodeDataModel()->nPorts(port.type);
+}
+
+
+std::vector<NodeGroupModel::Port>
+NodeGroupModel::
+collectPorts(PortType portType) const
+{
+  std::unordered_set<Node const*> const members(_nodes.begin(), _nodes.end());
+
+  std::vector<Port> result;
+
+  for (Node* node : _nodes)
+  {
+    auto const &entries = node->nodeState().getEntries(portType);
+
+    for (PortIndex i = 0; i < static_cast<PortIndex>(entries.size()); ++i)
+    {
+      for (auto const &pair : entries[i])
+      {
+        Node const* other = pair.second->getNode(oppositePort(portType));
+
+        if (other && !members.count(other))
+        {
+          result.push_back({ node, portType, i });
+          break;
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+
+void
+NodeGroupModel::
+rebuildPorts()
+{
+  replacePorts(PortType::In, collectPorts(PortType::In));
+  replacePorts(PortType::Out, collectPorts(PortType::Out));
+}
+
+
+void
+NodeGroupModel::
+replacePorts(PortType portType, std::vector<Port> ports)
+{
+  auto &current = (portType == PortType::In) ? _inPorts : _outPorts;
+
+  // all old ports go, all new ones come: indices may shift anywhere
+  if (!current.empty())
+  {
+    PortIndex const last = static_cast<PortIndex>(current.size()) - 1;
+
+    portsAboutToBeDeleted(portType, 0, last);
+
+    current.clear();
+    rebuildPortMap();
+
+    portsDeleted(portType, 0, last);
+  }
+
+  if (!ports.empty())
+  {
+    current = std::move(ports);
+    rebuildPortMap();
+
+    portsInserted(portType, 0, static_cast<PortIndex>(current.size()) - 1);
+  }
+}
+
+
+void
+NodeGroupModel::
+rebuildPortMap()
+{
+  _portMap.clear();
+  _portMap.reserve(_nodes.size());
+
+  for (Node* node : _nodes)
+  {
+    PortMap &map = _portMap[node];
+
+    NodeDataModel const* model = node->nodeDataModel();
+
+    map.in.assign(model->nPorts(PortType::In), INVALID);
+    map.out.assign(model->nPorts(PortType::Out), INVALID);
+  }
+
+  for (PortType portType : { PortType::In, PortType::Out })
+  {
+    auto const &group = ports(portType);
+
+    for (PortIndex i = 0; i < static_cast<PortIndex>(group.size()); ++i)
+    {
+      Port const &port = group[i];
+
+      auto &map = (portType == PortType::In) ? _portMap[port.node].in
+                                             : _portMap[port.node].out;
+
+      if (port.index < static_cast<PortIndex>(map.size()))
+        map[port.index] = i;
+    }
+  }
+}
+
+
+QString
+NodeGroupModel::
+caption() const
+{
+  return QStringLiteral("Group (%1 nodes)").arg(_nodes.size());
+}
+
+
+std::unique_ptr<NodeDataModel>
+NodeGroupModel::
+clone() const
+{
+  // the inner nodes belong to this group only
+  return std::make_unique<NodeGroupModel>(std::vector<Node*>(), QPointF());
+}
+
+
+QString
+NodeGroupModel::
+portCaption(PortType portType, PortIndex portIndex) const
+{
+  Port const &port = ports(portType)[portIndex];
+
+  NodeDataModel const* model = port.node->nodeDataModel();
+
+  // between an inner port change and rebuildPorts()
+  if (!isCurrent(port))
+    return model->caption();
+
+  QString const portName = model->portCaptionVisible(port.type, port.index)
+                           ? model->portCaption(port.type, port.index)
+                           : model->dataType(port.type, port.index).name;
+
+  return model->caption() + QStringLiteral(": ") + portName;
+}
+
+
+unsigned int
+NodeGroupModel::
+nPorts(PortType portType) const
+{
+  return static_cast<unsigned int>(ports(portType).size());
+}
+
+
+NodeDataType
+NodeGroupModel::
+dataType(PortType portType, PortIndex portIndex) const
+{
+  Port const &port = ports(portType)[portIndex];
+
+  if (!isCurrent(port))
+    return NodeDataType();
+
+  return port.node->nodeDataModel()->dataType(port.type, port.index);
+}
+
+
+std::vector<NodeGroupModel::Port> const &
+NodeGroupModel::
+ports(PortType portType) const
+{
+  return (portType == PortType::In) ? _inPorts : _outPorts;
+}
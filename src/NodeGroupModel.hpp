@@ -0,0 +1,136 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include <QtCore/QPointF>
+
+#include "NodeDataModel.hpp"
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class Node;
+class Connection;
+
+/// Model of the node standing in for collapsed nodes,
+/// see FlowScene::collapseNodes().
+///
+/// Its ports mirror the ports of the inner nodes that have connections
+/// leaving the group. The model takes no part in evaluation: these
+/// connections stay attached to the inner nodes, only their ends are
+/// drawn at the group's ports. When an inner model inserts or deletes
+/// ports the group's ports are rebuilt and announced with the group's
+/// own port signals.
+class NODE_EDITOR_PUBLIC NodeGroupModel
+  : public NodeDataModel
+{
+  Q_OBJECT
+
+public:
+
+  /// An inner port with connections leaving the group
+  struct Port
+  {
+    Node*     node;
+    PortType  type;
+    PortIndex index;
+  };
+
+  /// Ports are read from the current connections of `nodes`
+  NodeGroupModel(std::vector<Node*> nodes, QPointF const& origin);
+
+public:
+
+  std::vector<Node*> const &
+  nodes() const { return _nodes; }
+
+  /// Position of the group node when it was collapsed;
+  /// inner nodes move along with the group node
+  QPointF
+  origin() const { return _origin; }
+
+  /// Group port shown for an inner port, INVALID if the port
+  /// has no connections leaving the group
+  PortIndex
+  groupPort(Node const& node, PortType portType, PortIndex portIndex) const;
+
+  /// Connections between inner and outer nodes
+  std::vector<Connection*>
+  boundaryConnections() const;
+
+public:
+
+  QString
+  caption() const override;
+
+  QString
+  name() const override { return QStringLiteral("Group"); }
+
+  std::unique_ptr<NodeDataModel>
+  clone() const override;
+
+  QString
+  portCaption(PortType portType, PortIndex portIndex) const override;
+
+  bool
+  portCaptionVisible(PortType, PortIndex) const override { return true; }
+
+  unsigned int
+  nPorts(PortType portType) const override;
+
+  NodeDataType
+  dataType(PortType portType, PortIndex portIndex) const override;
+
+  void
+  setInData(std::shared_ptr<NodeData>, PortIndex) override {}
+
+  std::shared_ptr<NodeData>
+  outData(PortIndex) override { return nullptr; }
+
+  QWidget *
+  embeddedWidget() override { return nullptr; }
+
+private:
+
+  std::vector<Port> const &
+  ports(PortType portType) const;
+
+  /// False if the inner model no longer has the port
+  static
+  bool
+  isCurrent(Port const& port);
+
+  /// Inner ports with connections to nodes outside the group
+  std::vector<Port>
+  collectPorts(PortType portType) const;
+
+  void
+  rebuildPorts();
+
+  void
+  replacePorts(PortType portType, std::vector<Port> ports);
+
+  void
+  rebuildPortMap();
+
+private:
+
+  std::vector<Node*> _nodes;
+
+  std::vector<Port> _inPorts;
+  std::vector<Port> _outPorts;
+
+  QPointF _origin;
+
+  /// Group port of every port of an inner node
+  struct PortMap
+  {
+    std::vector<PortIndex> in;
+    std::vector<PortIndex> out;
+  };
+
+  std::unordered_map<Node const*, PortMap> _portMap;
+};
+}
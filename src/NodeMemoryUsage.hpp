@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+namespace QtNodes
+{
+
+/// Bytes attributed to one node, see Node::memoryUsage()
+struct NodeMemoryUsage
+{
+  /// Payloads last received on the input ports
+  std::size_t inputBytes = 0;
+
+  /// Payloads last sent from the output ports
+  std::size_t outputBytes = 0;
+
+  /// Reported by NodeDataModel::memoryUsage()
+  std::size_t modelBytes = 0;
+
+  /// Item cache pixmaps of the node's graphics items
+  std::size_t graphicsBytes = 0;
+
+  std::size_t
+  total() const { return inputBytes + outputBytes + modelBytes + graphicsBytes; }
+};
+}
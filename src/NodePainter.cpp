@@ -1,6 +1,7 @@
 #include "NodePainter.hpp"
 
 #include <cmath>
+#include <algorithm>
 
 #include <QtCore/QMargins>
 
@@ -12,6 +13,10 @@
 #include "NodeDataModel.hpp"
 #include "Node.hpp"
 #include "FlowScene.hpp"
+#include "TextMetricsCache.hpp"
+#include "NodeSpriteCache.hpp"
+#include "RenderStatistics.hpp"
+#include "Trace.hpp"
 
 using QtNodes::NodePainter;
 using QtNodes::NodeGeometry;
@@ -19,7 +24,12 @@ using QtNodes::NodeGraphicsObject;
 using QtNodes::Node;
 using QtNodes::NodeState;
 using QtNodes::NodeDataModel;
+using QtNodes::NodePortTable;
+using QtNodes::PortDescriptor;
+using QtNodes::TypeId;
 using QtNodes::FlowScene;
+using QtNodes::NodeProfile;
+using QtNodes::RenderCounters;
 
 void
 NodePainter::
@@ -27,13 +37,19 @@ paint(QPainter* painter,
       Node & node, 
       FlowScene const& scene)
 {
+  NODE_EDITOR_TRACE_SCOPE("paint", "NodePainter::paint");
+
+  ++RenderCounters::totals().paintedNodes;
+
   NodeGeometry const& geom = node.nodeGeometry();
 
   NodeState const& state = node.nodeState();
 
   NodeGraphicsObject const & graphicsObject = node.nodeGraphicsObject();
 
-  geom.recalculateSize(painter->font());
+  // the layout is kept up to date by NodeGraphicsObject::relayout,
+  // painting only reads it
+  painter->setFont(geom.font());
 
   //--------------------------------------------
   auto const &model = node.nodeDataModel();
@@ -41,18 +57,23 @@ paint(QPainter* painter,
   drawNodeRect(painter, geom, model, graphicsObject);
 
 
-  drawConnectionPoints(painter, geom, state, model, scene);
+  NodePortTable const & ports = node.portTable();
 
-  drawFilledConnectionPoints(painter, geom, state, model);
+  drawConnectionPoints(painter, geom, state, model, ports, scene);
+
+  drawFilledConnectionPoints(painter, geom, state, ports);
 
   drawModelName(painter, geom, state, model);
 
-  drawEntryLabels(painter, geom, state, model);
+  drawEntryLabels(painter, geom, state, ports);
 
   drawResizeRect(painter, geom, model);
 
   drawValidationRect(painter, geom, model, graphicsObject);
 
+  if (scene.isProfilingHeatmapVisible())
+    drawProfile(painter, geom, node);
+
   /// call custom painter
   if (auto painterDelegate = model->painterDelegate())
   {
@@ -85,22 +106,19 @@ drawNodeRect(QPainter* painter,
     painter->setPen(p);
   }
 
-  QLinearGradient gradient(QPointF(0.0, 0.0),
-                           QPointF(2.0, geom.height()));
-
-  gradient.setColorAt(0.0,  nodeStyle.GradientColor0);
-  gradient.setColorAt(0.03, nodeStyle.GradientColor1);
-  gradient.setColorAt(0.97, nodeStyle.GradientColor2);
-  gradient.setColorAt(1.0,  nodeStyle.GradientColor3);
-
-  painter->setBrush(gradient);
-
   float diam = nodeStyle.ConnectionPointDiameter;
 
   QRectF    boundary( -diam, -diam, 2.0*diam + geom.width(), 2.0*diam + geom.height());
 
   double const radius = 3.0;
 
+  // shadow and gradient fill come from sprites shared by all nodes
+  NodeSpriteCache::drawShadow(painter, boundary, nodeStyle);
+
+  NodeSpriteCache::drawBody(painter, boundary, radius, nodeStyle);
+
+  painter->setBrush(Qt::NoBrush);
+
   painter->drawRoundedRect(boundary, radius, radius);
 }
 
@@ -111,6 +129,7 @@ drawConnectionPoints(QPainter* painter,
                      NodeGeometry const& geom,
                      NodeState const& state,
                      NodeDataModel const* model,
+                     NodePortTable const & ports,
                      FlowScene const & scene)
 {
   NodeStyle const& nodeStyle      = StyleCollection::nodeStyle();
@@ -129,12 +148,14 @@ drawConnectionPoints(QPainter* painter,
 
       QPointF p = geom.portScenePosition(i, portType);
 
-      auto const & dataType = model->dataType(portType, i);
+      PortDescriptor const & port = ports.port(portType, i);
+
+      TypeId const typeId = port.typeId;
 
       double r = 1.0;
       if (state.isReacting() &&
           (state.getEntries(portType)[i].empty() ||
-           model->nodeConnectionPolicy(portType, i) == NodeDataModel::Many) &&
+           port.connectionPolicy == NodeDataModel::Many) &&
            portType == state.reactingPortType())
       {
 
@@ -145,15 +166,15 @@ drawConnectionPoints(QPainter* painter,
         {
           if (portType == PortType::In)
           {
-            typeConvertable = scene.registry().getTypeConverter(state.reactingDataType().id, dataType.id) != nullptr;
+            typeConvertable = scene.registry().hasTypeConverter(state.reactingTypeId(), typeId);
           }
           else
           {
-            typeConvertable = scene.registry().getTypeConverter(dataType.id, state.reactingDataType().id) != nullptr;
+            typeConvertable = scene.registry().hasTypeConverter(typeId, state.reactingTypeId());
           }
         }
 
-        if (state.reactingDataType().id == dataType.id || typeConvertable)
+        if (state.reactingTypeId() == typeId || typeConvertable)
         {
           double const thres = 40.0;
           r = (dist < thres) ?
@@ -171,7 +192,7 @@ drawConnectionPoints(QPainter* painter,
 
       if (connectionStyle.useDataDefinedColors())
       {
-        painter->setBrush(connectionStyle.normalColor(dataType.id));
+        painter->setBrush(connectionStyle.normalColor(typeId));
       }
       else
       {
@@ -194,7 +215,7 @@ NodePainter::
 drawFilledConnectionPoints(QPainter * painter,
                            NodeGeometry const & geom,
                            NodeState const & state,
-                           NodeDataModel const* model)
+                           NodePortTable const & ports)
 {
   NodeStyle const& nodeStyle       = StyleCollection::nodeStyle();
   auto const     & connectionStyle = StyleCollection::connectionStyle();
@@ -212,11 +233,9 @@ drawFilledConnectionPoints(QPainter * painter,
 
       if (!state.getEntries(portType)[i].empty())
       {
-        auto const & dataType = model->dataType(portType, i);
-
         if (connectionStyle.useDataDefinedColors())
         {
-          QColor const c = connectionStyle.normalColor(dataType.id);
+          QColor const c = connectionStyle.normalColor(ports.port(portType, i).typeId);
           painter->setPen(c);
           painter->setBrush(c);
         }
@@ -252,22 +271,21 @@ drawModelName(QPainter * painter,
   if (!model->captionVisible())
     return;
 
-  QString const &name = model->caption();
+  QStaticText const &caption = geom.captionText();
 
   QFont f = painter->font();
 
   f.setBold(true);
 
-  QFontMetrics metrics(f);
-
-  auto rect = metrics.boundingRect(name);
+  double const ascent = geom.boldTextMetrics().fontMetrics().ascent();
 
-  QPointF position((geom.width() - rect.width()) / 2.0,
-                   (geom.spacing() + geom.entryHeight()) / 3.0);
+  // static text is positioned by its top left corner, not the baseline
+  QPointF position((geom.width() - caption.size().width()) / 2.0,
+                   (geom.spacing() + geom.entryHeight()) / 3.0 - ascent);
 
   painter->setFont(f);
   painter->setPen(nodeStyle.FontColor);
-  painter->drawText(position, name);
+  painter->drawStaticText(position, caption);
 
   f.setBold(false);
   painter->setFont(f);
@@ -279,10 +297,9 @@ NodePainter::
 drawEntryLabels(QPainter * painter,
                 NodeGeometry const & geom,
                 NodeState const & state,
-                NodeDataModel const* model)
+                NodePortTable const & ports)
 {
-  QFontMetrics const & metrics =
-    painter->fontMetrics();
+  double const ascent = geom.textMetrics().fontMetrics().ascent();
 
   auto drawPoints =
   [&](PortType portType)
@@ -302,20 +319,9 @@ drawEntryLabels(QPainter * painter,
       else
         painter->setPen(nodeStyle.FontColor);
 
-      QString s;
+      PortDescriptor const & port = ports.port(portType, i);
 
-      if (model->portCaptionVisible(portType, i))
-      {
-        s = model->portCaption(portType, i);
-      }
-      else
-      {
-        s = model->dataType(portType, i).name;
-      }
-
-      auto rect = metrics.boundingRect(s);
-
-      p.setY(p.y() + rect.height() / 4.0);
+      p.setY(p.y() + geom.entryHeight() / 4.0 - ascent);
 
       switch (portType)
       {
@@ -324,14 +330,14 @@ drawEntryLabels(QPainter * painter,
           break;
 
         case PortType::Out:
-          p.setX(geom.width() - 5.0 - rect.width());
+          p.setX(geom.width() - 5.0 - port.labelWidth);
           break;
 
         default:
           break;
       }
 
-      painter->drawText(p, s);
+      painter->drawStaticText(p, port.labelText);
     }
   };
 
@@ -355,6 +361,60 @@ drawResizeRect(QPainter * painter,
   }
 }
 
+void
+NodePainter::
+drawProfile(QPainter* painter,
+            NodeGeometry const& geom,
+            Node const& node)
+{
+  NodeProfile const &profile = node.profile();
+
+  if (profile.calls == 0)
+    return;
+
+  NodeStyle const& nodeStyle = StyleCollection::nodeStyle();
+
+  float diam = nodeStyle.ConnectionPointDiameter;
+
+  // green at 10us per call, red at 10ms and above
+  double const meanNs = profile.selfNs / double(profile.calls);
+  double const cost   = std::log10(std::max(meanNs, 1.0) / 1e4) / 3.0;
+
+  QColor tint = QColor::fromHsvF((1.0 - std::min(std::max(cost, 0.0), 1.0)) / 3.0,
+                                 0.9, 0.9);
+  tint.setAlphaF(0.35);
+
+  QRectF boundary(-diam, -diam, 2.0*diam + geom.width(), 2.0*diam + geom.height());
+
+  double const radius = 3.0;
+
+  painter->setPen(Qt::NoPen);
+  painter->setBrush(tint);
+  painter->drawRoundedRect(boundary, radius, radius);
+
+  // the badge sits above the node, inside the bounding rect margin
+  QString const text = QStringLiteral("%1 ms  x%2")
+                       .arg(profile.meanSelfMs(), 0, 'f', 2)
+                       .arg(profile.calls);
+
+  auto const &metrics = geom.textMetrics();
+
+  QRectF badge(0.0, 0.0,
+               metrics.width(text) + 8.0,
+               metrics.height() + 2.0);
+
+  badge.moveBottomRight(QPointF(boundary.right(), boundary.top() - 2.0));
+
+  tint.setAlphaF(1.0);
+
+  painter->setBrush(tint.darker(250));
+  painter->drawRoundedRect(badge, radius, radius);
+
+  painter->setPen(nodeStyle.FontColor);
+  painter->drawText(badge, Qt::AlignCenter, text);
+}
+
+
 void
 NodePainter::
 drawValidationRect(QPainter * painter,
@@ -406,19 +466,14 @@ drawValidationRect(QPainter * painter,
     painter->setBrush(Qt::gray);
 
     //Drawing the validation message itself
-    QString const &errorMsg = model->validationMessage();
-
-    QFont f = painter->font();
-    
-    QFontMetrics metrics(f);
+    QStaticText const &errorMsg = geom.validationText();
 
-    auto rect = metrics.boundingRect(errorMsg);
+    double const ascent = geom.textMetrics().fontMetrics().ascent();
 
-    QPointF position((geom.width() - rect.width()) / 2.0,
-      geom.height() - (geom.validationHeight() - diam) / 2.0);
+    QPointF position((geom.width() - errorMsg.size().width()) / 2.0,
+      geom.height() - (geom.validationHeight() - diam) / 2.0 - ascent);
 
-    painter->setFont(f);
     painter->setPen(nodeStyle.FontColor);
-    painter->drawText(position, errorMsg);
+    painter->drawStaticText(position, errorMsg);
   }
 }
@@ -12,6 +12,7 @@ class NodeState;
 class NodeGeometry;
 class NodeGraphicsObject;
 class NodeDataModel;
+class NodePortTable;
 class FlowItemEntry;
 class FlowScene;
 
@@ -48,7 +49,7 @@ public:
   drawEntryLabels(QPainter* painter,
                   NodeGeometry const& geom,
                   NodeState const& state,
-                  NodeDataModel const * model);
+                  NodePortTable const & ports);
 
   static
   void
@@ -56,6 +57,7 @@ public:
                        NodeGeometry const& geom,
                        NodeState const& state,
                        NodeDataModel const * model,
+                       NodePortTable const & ports,
                        FlowScene const & scene);
 
   static
@@ -63,7 +65,7 @@ public:
   drawFilledConnectionPoints(QPainter* painter,
                              NodeGeometry const& geom,
                              NodeState const& state,
-                             NodeDataModel const * model);
+                             NodePortTable const & ports);
 
   static
   void
@@ -71,6 +73,13 @@ public:
                  NodeGeometry const& geom,
                  NodeDataModel const * model);
 
+  /// Heatmap tint and timing badge of a profiled node
+  static
+  void
+  drawProfile(QPainter* painter,
+              NodeGeometry const& geom,
+              Node const& node);
+
   static
   void
   drawValidationRect(QPainter * painter,
@@ -0,0 +1,122 @@
+#include "NodePortTable.hpp"
+
+#include <algorithm>
+
+#include "TextMetricsCache.hpp"
+
+using QtNodes::NodePortTable;
+using QtNodes::PortDescriptor;
+using QtNodes::NodeDataModel;
+using QtNodes::NodeDataTypeRegistry;
+using QtNodes::PortType;
+using QtNodes::PortIndex;
+
+NodePortTable::
+NodePortTable(NodeDataModel const &model)
+  : _maxInLabelWidth(0)
+  , _maxOutLabelWidth(0)
+  , _labelsMeasured(false)
+{
+  rebuild(model);
+}
+
+
+void
+NodePortTable::
+rebuild(NodeDataModel const &model)
+{
+  auto fill =
+    [&model](PortType portType, std::vector<PortDescriptor> &ports)
+    {
+      unsigned int const n = model.nPorts(portType);
+
+      ports.clear();
+      ports.reserve(n);
+
+      for (unsigned int i = 0; i < n; ++i)
+      {
+        PortDescriptor d;
+
+        d.dataType         = model.dataType(portType, i);
+        d.typeId           = NodeDataTypeRegistry::intern(d.dataType.id);
+        d.caption          = model.portCaption(portType, i);
+        d.captionVisible   = model.portCaptionVisible(portType, i);
+        d.connectionPolicy = model.nodeConnectionPolicy(portType, i);
+        d.label            = d.captionVisible ? d.caption : d.dataType.name;
+
+        ports.push_back(d);
+      }
+    };
+
+  fill(PortType::In,  _inPorts);
+  fill(PortType::Out, _outPorts);
+
+  _maxInLabelWidth  = 0;
+  _maxOutLabelWidth = 0;
+  _labelsMeasured   = false;
+}
+
+
+void
+NodePortTable::
+measureLabels(TextMetrics const &metrics)
+{
+  auto measure =
+    [&metrics](std::vector<PortDescriptor> &ports)
+    {
+      unsigned int maxWidth = 0;
+
+      for (auto &d : ports)
+      {
+        d.labelWidth = unsigned(metrics.width(d.label));
+        d.labelText  = metrics.staticText(d.label);
+
+        maxWidth = std::max(maxWidth, d.labelWidth);
+      }
+
+      return maxWidth;
+    };
+
+  _maxInLabelWidth  = measure(_inPorts);
+  _maxOutLabelWidth = measure(_outPorts);
+
+  _labelsMeasured = true;
+}
+
+
+unsigned int
+NodePortTable::
+nPorts(PortType portType) const
+{
+  return static_cast<unsigned int>(ports(portType).size());
+}
+
+
+PortDescriptor const &
+NodePortTable::
+port(PortType portType, PortIndex portIndex) const
+{
+  return ports(portType)[portIndex];
+}
+
+
+std::vector<PortDescriptor> const &
+NodePortTable::
+ports(PortType portType) const
+{
+  if (portType == PortType::In)
+    return _inPorts;
+  else
+    return _outPorts;
+}
+
+
+unsigned int
+NodePortTable::
+maxLabelWidth(PortType portType) const
+{
+  if (portType == PortType::In)
+    return _maxInLabelWidth;
+  else
+    return _maxOutLabelWidth;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include <QtCore/QString>
+#include <QtGui/QStaticText>
+
+#include "PortType.hpp"
+#include "NodeData.hpp"
+#include "NodeDataModel.hpp"
+#include "NodeDataTypeRegistry.hpp"
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class TextMetrics;
+
+/// Everything the framework needs to know about a single port.
+struct PortDescriptor
+{
+  NodeDataType dataType;
+
+  TypeId typeId = INVALID_TYPE_ID;
+
+  QString caption;
+
+  bool captionVisible = false;
+
+  NodeDataModel::NodeConnectionPolicy connectionPolicy = NodeDataModel::Many;
+
+  /// Text drawn next to the port: the caption if visible,
+  /// otherwise the data type name
+  QString label;
+
+  /// Width of `label` in the node font, see NodePortTable::measureLabels
+  unsigned int labelWidth = 0;
+
+  /// `label` laid out in the node font
+  QStaticText labelText;
+};
+
+/// Immutable snapshot of a model's port layout.
+/// Built from the virtual NodeDataModel interface and rebuilt only when
+/// the model emits `portsChanged`, so painting, layout and hit tests read
+/// plain data instead of querying the model for every port.
+class NODE_EDITOR_PUBLIC NodePortTable
+{
+public:
+
+  NodePortTable(NodeDataModel const &model);
+
+public:
+
+  /// Re-reads the port layout from the model.
+  /// Label widths have to be measured again afterwards.
+  void
+  rebuild(NodeDataModel const &model);
+
+  /// Caches the label widths and laid out labels for the given metrics
+  void
+  measureLabels(TextMetrics const &metrics);
+
+  bool
+  labelsMeasured() const { return _labelsMeasured; }
+
+  unsigned int
+  nPorts(PortType portType) const;
+
+  PortDescriptor const &
+  port(PortType portType, PortIndex portIndex) const;
+
+  std::vector<PortDescriptor> const &
+  ports(PortType portType) const;
+
+  /// Widest label among the ports of the given side
+  unsigned int
+  maxLabelWidth(PortType portType) const;
+
+private:
+
+  std::vector<PortDescriptor> _inPorts;
+  std::vector<PortDescriptor> _outPorts;
+
+  unsigned int _maxInLabelWidth;
+  unsigned int _maxOutLabelWidth;
+
+  bool _labelsMeasured;
+};
+}
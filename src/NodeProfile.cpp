@@ -0,0 +1,47 @@
+#include "NodeProfile.hpp"
+
+#include <algorithm>
+
+using QtNodes::ProfileScope;
+using QtNodes::NodeProfile;
+
+namespace
+{
+
+thread_local ProfileScope* currentScope = nullptr;
+}
+
+ProfileScope::
+ProfileScope(NodeProfile* profile)
+  : _profile(profile)
+  , _parent(nullptr)
+  , _childNs(0)
+{
+  if (!_profile)
+    return;
+
+  _parent      = currentScope;
+  currentScope = this;
+
+  _timer.start();
+}
+
+
+ProfileScope::
+~ProfileScope()
+{
+  if (!_profile)
+    return;
+
+  qint64 const elapsed = _timer.nsecsElapsed();
+
+  _profile->calls   += 1;
+  _profile->totalNs += elapsed;
+  _profile->selfNs  += elapsed - _childNs;
+  _profile->maxNs    = std::max(_profile->maxNs, elapsed);
+
+  if (_parent)
+    _parent->_childNs += elapsed;
+
+  currentScope = _parent;
+}
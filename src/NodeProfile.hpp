@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QElapsedTimer>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Timings of the `setInData` calls of one node, in nanoseconds.
+/// Data propagation is synchronous, so `totalNs` includes the nodes
+/// evaluated downstream from within the call; `selfNs` excludes them.
+struct NodeProfile
+{
+  quint64 calls   = 0;
+  qint64  totalNs = 0;
+  qint64  selfNs  = 0;
+  qint64  maxNs   = 0;
+
+  double
+  meanMs() const { return calls ? totalNs / 1e6 / calls : 0.0; }
+
+  double
+  meanSelfMs() const { return calls ? selfNs / 1e6 / calls : 0.0; }
+};
+
+
+/// Times one call into `profile` while alive.
+/// Scopes nest per thread: the time of an inner scope is subtracted
+/// from the self time of the enclosing one.
+/// A null profile makes the scope a no-op.
+class NODE_EDITOR_PUBLIC ProfileScope
+{
+public:
+
+  explicit
+  ProfileScope(NodeProfile* profile);
+
+  ~ProfileScope();
+
+  ProfileScope(ProfileScope const&) = delete;
+  ProfileScope& operator=(ProfileScope const&) = delete;
+
+private:
+
+  NodeProfile*  _profile;
+  ProfileScope* _parent;
+
+  qint64 _childNs;
+
+  QElapsedTimer _timer;
+};
+}
@@ -0,0 +1,267 @@
+#include "NodeSpriteCache.hpp"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <QtGui/QImage>
+#include <QtGui/QPixmap>
+#include <QtGui/QPixmapCache>
+#include <QtGui/QLinearGradient>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <QtWidgets/qdrawutil.h>
+
+#include "NodeStyle.hpp"
+#include "RenderStatistics.hpp"
+
+using QtNodes::NodeSpriteCache;
+using QtNodes::NodeStyle;
+using QtNodes::RenderCounters;
+
+namespace
+{
+
+double const shadowBlurRadius   = 12.0;
+double const shadowCornerRadius = 3.0;
+
+/// One horizontal or vertical box blur pass over `n` pixels.
+/// Pixels outside the image count as transparent.
+void
+blurLine(QRgb* data, int n, int stride, int radius, std::vector<QRgb> &line)
+{
+  for (int i = 0; i < n; ++i)
+    line[i] = data[i * stride];
+
+  int const window = 2 * radius + 1;
+
+  int a = 0, r = 0, g = 0, b = 0;
+
+  auto add =
+    [&](int i, int sign)
+    {
+      if (i < 0 || i >= n)
+        return;
+
+      QRgb const p = line[i];
+
+      a += sign * qAlpha(p);
+      r += sign * qRed(p);
+      g += sign * qGreen(p);
+      b += sign * qBlue(p);
+    };
+
+  for (int i = -radius; i < radius; ++i)
+    add(i, +1);
+
+  for (int i = 0; i < n; ++i)
+  {
+    add(i + radius, +1);
+
+    data[i * stride] = qRgba(r / window, g / window, b / window, a / window);
+
+    add(i - radius, -1);
+  }
+}
+
+
+/// Three box blur passes approximate a gaussian blur
+void
+blurImage(QImage &image, int radius)
+{
+  if (radius < 1)
+    return;
+
+  int const w      = image.width();
+  int const h      = image.height();
+  int const stride = image.bytesPerLine() / 4;
+
+  std::vector<QRgb> line(std::max(w, h));
+
+  auto bits = reinterpret_cast<QRgb*>(image.bits());
+
+  int const passRadius = std::max(1, radius / 3);
+
+  for (int pass = 0; pass < 3; ++pass)
+  {
+    for (int y = 0; y < h; ++y)
+      blurLine(bits + y * stride, w, 1, passRadius, line);
+
+    for (int x = 0; x < w; ++x)
+      blurLine(bits + x, h, stride, passRadius, line);
+  }
+}
+
+
+QString
+colorKey(QColor const &c)
+{
+  return QString::number(c.rgba(), 16);
+}
+
+
+bool
+findSprite(QString const &key, QPixmap &sprite)
+{
+  bool const found = QPixmapCache::find(key, &sprite);
+
+  if (found)
+    ++RenderCounters::totals().spriteCacheHits;
+  else
+    ++RenderCounters::totals().spriteCacheMisses;
+
+  return found;
+}
+}
+
+void
+NodeSpriteCache::
+drawShadow(QPainter* painter,
+           QRectF const& rect,
+           NodeStyle const& nodeStyle)
+{
+  double const scale = zoomBucket(painter);
+
+  // the corner patch covers the blur on both sides of the edge
+  // plus the rounded corner itself
+  int const corner     = int(std::ceil(2 * shadowBlurRadius + shadowCornerRadius));
+  int const spriteSize = 2 * corner + 1;
+
+  QString const key = QStringLiteral("qtnodes-shadow:%1:%2")
+                      .arg(colorKey(nodeStyle.ShadowColor))
+                      .arg(scale);
+
+  QPixmap sprite;
+
+  if (!findSprite(key, sprite))
+  {
+    int const pixels = int(std::ceil(spriteSize * scale));
+
+    QImage image(pixels, pixels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    {
+      QPainter p(&image);
+      p.setRenderHint(QPainter::Antialiasing);
+      p.scale(scale, scale);
+      p.setPen(Qt::NoPen);
+      p.setBrush(nodeStyle.ShadowColor);
+
+      QRectF const shape(shadowBlurRadius, shadowBlurRadius,
+                         spriteSize - 2 * shadowBlurRadius,
+                         spriteSize - 2 * shadowBlurRadius);
+
+      p.drawRoundedRect(shape, shadowCornerRadius, shadowCornerRadius);
+    }
+
+    blurImage(image, int(shadowBlurRadius * scale));
+
+    sprite = QPixmap::fromImage(image);
+
+    QPixmapCache::insert(key, sprite);
+  }
+
+  QRectF const shadowRect =
+    rect.translated(shadowOffset()).adjusted(-shadowBlurRadius, -shadowBlurRadius,
+                                             shadowBlurRadius, shadowBlurRadius);
+
+  QRect const target = shadowRect.toAlignedRect();
+
+  // small nodes get proportionally smaller corners
+  int const targetCorner = std::min(corner,
+                                    std::min(target.width(), target.height()) / 2);
+
+  int const sourceCorner = int(std::floor(corner * scale));
+
+  qDrawBorderPixmap(painter,
+                    target,
+                    QMargins(targetCorner, targetCorner, targetCorner, targetCorner),
+                    sprite,
+                    sprite.rect(),
+                    QMargins(sourceCorner, sourceCorner, sourceCorner, sourceCorner));
+}
+
+
+void
+NodeSpriteCache::
+drawBody(QPainter* painter,
+         QRectF const& rect,
+         double radius,
+         NodeStyle const& nodeStyle)
+{
+  double const scale = zoomBucket(painter);
+
+  QString const key = QStringLiteral("qtnodes-body:%1x%2:%3:%4:%5:%6:%7:%8")
+                      .arg(rect.width())
+                      .arg(rect.height())
+                      .arg(scale)
+                      .arg(radius)
+                      .arg(colorKey(nodeStyle.GradientColor0))
+                      .arg(colorKey(nodeStyle.GradientColor1))
+                      .arg(colorKey(nodeStyle.GradientColor2))
+                      .arg(colorKey(nodeStyle.GradientColor3));
+
+  QPixmap sprite;
+
+  if (!findSprite(key, sprite))
+  {
+    QSize const pixels(int(std::ceil(rect.width() * scale)),
+                       int(std::ceil(rect.height() * scale)));
+
+    QImage image(pixels, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    {
+      QPainter p(&image);
+      p.setRenderHint(QPainter::Antialiasing);
+      p.scale(scale, scale);
+      p.setPen(Qt::NoPen);
+
+      QLinearGradient gradient(QPointF(0.0, 0.0),
+                               QPointF(2.0, rect.height()));
+
+      gradient.setColorAt(0.0,  nodeStyle.GradientColor0);
+      gradient.setColorAt(0.03, nodeStyle.GradientColor1);
+      gradient.setColorAt(0.97, nodeStyle.GradientColor2);
+      gradient.setColorAt(1.0,  nodeStyle.GradientColor3);
+
+      p.setBrush(gradient);
+
+      p.drawRoundedRect(QRectF(QPointF(0.0, 0.0), rect.size()), radius, radius);
+    }
+
+    sprite = QPixmap::fromImage(image);
+
+    QPixmapCache::insert(key, sprite);
+  }
+
+  painter->drawPixmap(rect, sprite, QRectF(sprite.rect()));
+}
+
+
+double
+NodeSpriteCache::
+shadowMargin()
+{
+  return shadowBlurRadius;
+}
+
+
+QPointF
+NodeSpriteCache::
+shadowOffset()
+{
+  return QPointF(4.0, 4.0);
+}
+
+
+double
+NodeSpriteCache::
+zoomBucket(QPainter const* painter)
+{
+  double const lod =
+    QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+
+  double const bucket = std::ceil(std::log2(std::max(lod, 1e-3)) * 4.0) / 4.0;
+
+  return std::pow(2.0, std::min(std::max(bucket, -3.0), 3.0));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QtCore/QRectF>
+#include <QtGui/QColor>
+#include <QtGui/QPainter>
+
+namespace QtNodes
+{
+
+class NodeStyle;
+
+/// Pre-rendered node decorations shared by all nodes.
+/// Replaces the per-item QGraphicsDropShadowEffect and per-item
+/// DeviceCoordinateCache pixmaps. Sprites live in QPixmapCache and are
+/// keyed by style and zoom bucket (plus size for the body), so memory
+/// does not grow with the node count.
+class NodeSpriteCache
+{
+public:
+
+  /// Draws a soft shadow below `rect` from a nine-patch sprite.
+  /// The shadow extends `shadowMargin()` beyond the offset rect.
+  static
+  void
+  drawShadow(QPainter* painter,
+             QRectF const& rect,
+             NodeStyle const& nodeStyle);
+
+  /// Fills the rounded node body with the style gradient
+  static
+  void
+  drawBody(QPainter* painter,
+           QRectF const& rect,
+           double radius,
+           NodeStyle const& nodeStyle);
+
+  static
+  double
+  shadowMargin();
+
+  static
+  QPointF
+  shadowOffset();
+
+private:
+
+  /// Device scale of the painter rounded to a quarter octave
+  static
+  double
+  zoomBucket(QPainter const* painter);
+};
+}
@@ -7,6 +7,8 @@
 using QtNodes::NodeState;
 using QtNodes::NodeDataType;
 using QtNodes::NodeDataModel;
+using QtNodes::NodeDataTypeRegistry;
+using QtNodes::TypeId;
 using QtNodes::PortType;
 using QtNodes::PortIndex;
 using QtNodes::Connection;
@@ -17,6 +19,7 @@ NodeState(std::unique_ptr<NodeDataModel> const &model)
   , _inConnections(model->nPorts(PortType::In))
   , _reaction(NOT_REACTING)
   , _reactingPortType(PortType::None)
+  , _reactingTypeId(INVALID_TYPE_ID)
   , _resizing(false)
 {}
 
@@ -76,6 +79,32 @@ eraseConnection(PortType portType,
 }
 
 
+void
+NodeState::
+insertPorts(PortType portType,
+            PortIndex first,
+            unsigned int count)
+{
+  auto &entries = getEntries(portType);
+
+  entries.insert(entries.begin() + first, count, ConnectionPtrSet());
+}
+
+
+void
+NodeState::
+erasePorts(PortType portType,
+           PortIndex first,
+           unsigned int count)
+{
+  auto &entries = getEntries(portType);
+
+  auto begin = entries.begin() + first;
+
+  entries.erase(begin, begin + count);
+}
+
+
 NodeState::ReactToConnectionState
 NodeState::
 reaction() const
@@ -100,6 +129,14 @@ reactingDataType() const
 }
 
 
+TypeId
+NodeState::
+reactingTypeId() const
+{
+  return _reactingTypeId;
+}
+
+
 void
 NodeState::
 setReaction(ReactToConnectionState reaction,
@@ -111,6 +148,8 @@ setReaction(ReactToConnectionState reaction,
   _reactingPortType = reactingPortType;
 
   _reactingDataType = reactingDataType;
+
+  _reactingTypeId = NodeDataTypeRegistry::intern(reactingDataType.id);
 }
 
 
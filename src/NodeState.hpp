@@ -8,6 +8,7 @@
 
 #include "PortType.hpp"
 #include "NodeData.hpp"
+#include "NodeDataTypeRegistry.hpp"
 
 namespace QtNodes
 {
@@ -56,6 +57,19 @@ public:
                   PortIndex portIndex,
                   QUuid id);
 
+  /// Adds `count` unconnected entries starting at `first`
+  void
+  insertPorts(PortType portType,
+              PortIndex first,
+              unsigned int count);
+
+  /// Removes `count` entries starting at `first`.
+  /// The entries are expected to have no connections left.
+  void
+  erasePorts(PortType portType,
+             PortIndex first,
+             unsigned int count);
+
   ReactToConnectionState
   reaction() const;
 
@@ -65,6 +79,9 @@ public:
   NodeDataType
   reactingDataType() const;
 
+  TypeId
+  reactingTypeId() const;
+
   void
   setReaction(ReactToConnectionState reaction,
               PortType reactingPortType = PortType::None,
@@ -89,6 +106,7 @@ private:
   ReactToConnectionState _reaction;
   PortType     _reactingPortType;
   NodeDataType _reactingDataType;
+  TypeId       _reactingTypeId;
 
   bool _resizing;
 };
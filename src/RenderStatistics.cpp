@@ -0,0 +1,46 @@
+#include "RenderStatistics.hpp"
+
+#include "TextMetricsCache.hpp"
+
+using QtNodes::RenderCounters;
+using QtNodes::TextMetricsCache;
+
+RenderCounters
+RenderCounters::
+operator-(RenderCounters const& other) const
+{
+  RenderCounters result;
+
+  result.paintedNodes       = paintedNodes       - other.paintedNodes;
+  result.paintedConnections = paintedConnections - other.paintedConnections;
+  result.layouts            = layouts            - other.layouts;
+  result.textCacheHits      = textCacheHits      - other.textCacheHits;
+  result.textCacheMisses    = textCacheMisses    - other.textCacheMisses;
+  result.spriteCacheHits    = spriteCacheHits    - other.spriteCacheHits;
+  result.spriteCacheMisses  = spriteCacheMisses  - other.spriteCacheMisses;
+
+  return result;
+}
+
+
+RenderCounters &
+RenderCounters::
+totals()
+{
+  static RenderCounters counters;
+
+  return counters;
+}
+
+
+RenderCounters
+RenderCounters::
+snapshot()
+{
+  RenderCounters result = totals();
+
+  result.textCacheHits   = TextMetricsCache::hits();
+  result.textCacheMisses = TextMetricsCache::misses();
+
+  return result;
+}
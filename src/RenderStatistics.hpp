@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Work done by the painters and the layout code.
+/// Painting happens on the GUI thread only, so the counters are plain.
+struct NODE_EDITOR_PUBLIC RenderCounters
+{
+  quint64 paintedNodes       = 0;
+  quint64 paintedConnections = 0;
+
+  /// Node layouts actually recomputed
+  quint64 layouts = 0;
+
+  quint64 textCacheHits   = 0;
+  quint64 textCacheMisses = 0;
+
+  quint64 spriteCacheHits   = 0;
+  quint64 spriteCacheMisses = 0;
+
+  /// Hit rate in [0, 1], 1 if nothing was looked up
+  double
+  textCacheHitRate() const { return hitRate(textCacheHits, textCacheMisses); }
+
+  double
+  spriteCacheHitRate() const { return hitRate(spriteCacheHits, spriteCacheMisses); }
+
+  RenderCounters
+  operator-(RenderCounters const& other) const;
+
+  /// Running totals the painters add to. The text cache fields are
+  /// unused here, TextMetricsCache keeps its own counters.
+  static
+  RenderCounters &
+  totals();
+
+  /// Current totals including the text cache counters
+  static
+  RenderCounters
+  snapshot();
+
+private:
+
+  static
+  double
+  hitRate(quint64 hits, quint64 misses)
+  { return hits + misses ? double(hits) / (hits + misses) : 1.0; }
+};
+
+
+/// Measurements of one painted FlowView frame
+struct FrameStatistics
+{
+  double frameMs      = 0.0;
+  double backgroundMs = 0.0;
+
+  /// Work done while painting the frame
+  RenderCounters counters;
+};
+}
@@ -0,0 +1,578 @@
+#include "RetainedData.hpp"
+
+#include <list>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+
+#include <QtCore/QDir>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QDebug>
+
+using QtNodes::RetainedData;
+using QtNodes::RetentionEntry;
+using QtNodes::DataRetention;
+using QtNodes::NodeData;
+
+namespace QtNodes
+{
+
+/// One RetainedData's reference to a payload
+struct RetentionEntry
+{
+  std::shared_ptr<NodeData> data;
+
+  bool pinned = false;
+};
+}
+
+namespace
+{
+
+/// A payload shared by one or more RetentionEntries.
+/// Spilling empties the NodeData object in place, so all holders
+/// see it spilled and any of them reads it back.
+struct Payload
+{
+  std::weak_ptr<NodeData> data;
+
+  /// Size while resident
+  std::size_t bytes = 0;
+
+  int holders = 0;
+  int pins    = 0;
+
+  bool spilled = false;
+
+  /// Record in the spill file
+  qint64 offset = 0;
+  qint64 length = 0;
+
+  std::list<NodeData const*>::iterator position;
+};
+
+
+struct RetentionState
+{
+  std::unordered_map<NodeData const*, Payload> payloads;
+
+  /// Most recently used first
+  std::list<NodeData const*> order;
+
+  std::size_t memoryLimit   = 0;
+  std::size_t diskLimit     = 0;
+  std::size_t residentBytes = 0;
+  std::size_t spilledBytes  = 0;
+
+  int spilledCount = 0;
+
+  /// Bytes of records in the spill file whose payload left it
+  qint64 deadBytes = 0;
+
+  QString spillDirectory;
+
+  std::unique_ptr<QTemporaryFile> spillFile;
+};
+
+
+RetentionState &
+retentionState()
+{
+  static RetentionState state;
+
+  return state;
+}
+
+
+std::unique_ptr<QTemporaryFile>
+createSpillFile()
+{
+  auto &state = retentionState();
+
+  QDir const directory(state.spillDirectory.isEmpty()
+                       ? QDir::tempPath()
+                       : state.spillDirectory);
+
+  std::unique_ptr<QTemporaryFile> file(
+    new QTemporaryFile(directory.filePath(QStringLiteral("qtnodes-spill-XXXXXX"))));
+
+  if (!file->open())
+  {
+    qWarning() << "Could not create a spill file in" << directory.path();
+    return nullptr;
+  }
+
+  return file;
+}
+
+
+QTemporaryFile*
+spillFile()
+{
+  auto &state = retentionState();
+
+  if (!state.spillFile)
+    state.spillFile = createSpillFile();
+
+  return state.spillFile.get();
+}
+
+
+/// Copies the live records to a new spill file and drops the old one.
+/// The old file stays in use if copying fails.
+void
+compactSpillFile()
+{
+  auto &state = retentionState();
+
+  std::unique_ptr<QTemporaryFile> file = createSpillFile();
+
+  if (!file || !state.spillFile)
+    return;
+
+  QTemporaryFile &old = *state.spillFile;
+
+  std::vector<std::pair<Payload*, qint64> > moved;
+  moved.reserve(state.spilledCount);
+
+  for (auto &entry : state.payloads)
+  {
+    Payload &payload = entry.second;
+
+    if (!payload.spilled)
+      continue;
+
+    qint64 const offset = file->pos();
+
+    if (!old.seek(payload.offset))
+      return;
+
+    for (qint64 left = payload.length; left > 0;)
+    {
+      QByteArray const chunk = old.read(std::min<qint64>(left, 1 << 20));
+
+      if (chunk.isEmpty() || file->write(chunk) != chunk.size())
+        return;
+
+      left -= chunk.size();
+    }
+
+    moved.emplace_back(&payload, offset);
+  }
+
+  for (auto const &m : moved)
+    m.first->offset = m.second;
+
+  state.spillFile = std::move(file);
+  state.deadBytes = 0;
+}
+
+
+void
+payloadLeftSpillFile(Payload &payload)
+{
+  auto &state = retentionState();
+
+  payload.spilled = false;
+
+  state.spilledBytes -= payload.bytes;
+  state.deadBytes    += payload.length;
+
+  --state.spilledCount;
+
+  if (!state.spillFile)
+    return;
+
+  if (state.spilledCount == 0)
+  {
+    // nothing in the file is alive any more, give the disk space back
+    state.spillFile->resize(0);
+    state.deadBytes = 0;
+  }
+  else if (state.deadBytes > state.spillFile->size() - state.deadBytes)
+  {
+    // dead records outweigh live ones, copying the live ones keeps
+    // the file at most twice their size
+    compactSpillFile();
+  }
+}
+
+
+bool
+spill(Payload &payload)
+{
+  if (payload.spilled || payload.pins > 0 || payload.bytes == 0)
+    return false;
+
+  // an owner outside RetainedData would keep the memory alive
+  if (payload.data.use_count() != payload.holders)
+    return false;
+
+  auto data = payload.data.lock();
+
+  if (!data)
+    return false;
+
+  auto &state = retentionState();
+
+  // drop the dead records before growing past the disk limit
+  if (state.diskLimit > 0 && state.deadBytes > 0 && state.spillFile &&
+      std::size_t(state.spillFile->size()) + payload.bytes > state.diskLimit)
+    compactSpillFile();
+
+  QTemporaryFile* file = spillFile();
+
+  if (!file)
+    return false;
+
+  qint64 const offset = file->size();
+
+  if (!file->seek(offset) || !data->spillPayload(*file) ||
+      (state.diskLimit > 0 && std::size_t(file->pos()) > state.diskLimit))
+  {
+    file->resize(offset);
+    return false;
+  }
+
+  payload.spilled = true;
+  payload.offset  = offset;
+  payload.length  = file->pos() - offset;
+
+  state.residentBytes -= payload.bytes;
+  state.spilledBytes  += payload.bytes;
+
+  ++state.spilledCount;
+
+  return true;
+}
+
+
+bool
+restore(Payload &payload)
+{
+  auto &state = retentionState();
+
+  auto data = payload.data.lock();
+
+  QTemporaryFile* file = state.spillFile.get();
+
+  bool const restored = data && file &&
+                        file->seek(payload.offset) &&
+                        data->restorePayload(*file);
+
+  payloadLeftSpillFile(payload);
+
+  if (restored)
+  {
+    state.residentBytes += payload.bytes;
+  }
+  else
+  {
+    qWarning() << "Could not read back spilled node data";
+
+    payload.bytes = 0;
+  }
+
+  return restored;
+}
+
+
+void
+enforceLimit()
+{
+  auto &state = retentionState();
+
+  if (state.memoryLimit > 0 && state.residentBytes > state.memoryLimit)
+    DataRetention::trim(state.memoryLimit);
+}
+
+
+void
+attach(RetentionEntry &entry, std::shared_ptr<NodeData> data)
+{
+  entry.data = std::move(data);
+
+  if (!entry.data)
+    return;
+
+  auto &state = retentionState();
+
+  Payload &payload = state.payloads[entry.data.get()];
+
+  if (payload.holders == 0)
+  {
+    payload.data     = entry.data;
+    payload.bytes    = entry.data->byteSize();
+    payload.position = state.order.insert(state.order.begin(), entry.data.get());
+
+    state.residentBytes += payload.bytes;
+  }
+
+  ++payload.holders;
+
+  if (entry.pinned)
+    ++payload.pins;
+}
+
+
+void
+detach(RetentionEntry &entry)
+{
+  if (!entry.data)
+    return;
+
+  auto &state = retentionState();
+
+  auto it = state.payloads.find(entry.data.get());
+
+  Q_ASSERT(it != state.payloads.end());
+
+  Payload &payload = it->second;
+
+  if (entry.pinned)
+    --payload.pins;
+
+  if (--payload.holders == 0)
+  {
+    if (payload.spilled)
+      payloadLeftSpillFile(payload);
+    else
+      state.residentBytes -= payload.bytes;
+
+    state.order.erase(payload.position);
+    state.payloads.erase(it);
+  }
+
+  entry.data.reset();
+}
+}
+
+RetainedData::
+RetainedData()
+  : _entry(new RetentionEntry)
+{}
+
+
+RetainedData::
+RetainedData(std::shared_ptr<NodeData> data)
+  : RetainedData()
+{
+  *this = std::move(data);
+}
+
+
+RetainedData::
+~RetainedData()
+{
+  detach(*_entry);
+}
+
+
+RetainedData&
+RetainedData::
+operator=(std::shared_ptr<NodeData> data)
+{
+  if (data == _entry->data)
+    return *this;
+
+  detach(*_entry);
+  attach(*_entry, std::move(data));
+
+  enforceLimit();
+
+  return *this;
+}
+
+
+std::shared_ptr<NodeData>
+RetainedData::
+get()
+{
+  if (!_entry->data)
+    return nullptr;
+
+  auto &state = retentionState();
+
+  Payload &payload = state.payloads[_entry->data.get()];
+
+  state.order.splice(state.order.begin(), state.order, payload.position);
+
+  if (payload.spilled && !restore(payload))
+    return nullptr;
+
+  // the extra reference keeps this payload resident while trimming
+  std::shared_ptr<NodeData> result = _entry->data;
+
+  enforceLimit();
+
+  return result;
+}
+
+
+void
+RetainedData::
+reset()
+{
+  detach(*_entry);
+}
+
+
+bool
+RetainedData::
+isNull() const
+{
+  return !_entry->data;
+}
+
+
+bool
+RetainedData::
+isSpilled() const
+{
+  if (!_entry->data)
+    return false;
+
+  return retentionState().payloads[_entry->data.get()].spilled;
+}
+
+
+void
+RetainedData::
+setPinned(bool pinned)
+{
+  if (_entry->pinned == pinned)
+    return;
+
+  _entry->pinned = pinned;
+
+  if (!_entry->data)
+    return;
+
+  Payload &payload = retentionState().payloads[_entry->data.get()];
+
+  payload.pins += pinned ? 1 : -1;
+
+  // a pinned payload must be in memory
+  if (pinned && payload.spilled)
+    restore(payload);
+}
+
+//------------------------------------------------------------------------------
+
+std::size_t
+DataRetention::
+memoryLimit()
+{
+  return retentionState().memoryLimit;
+}
+
+
+void
+DataRetention::
+setMemoryLimit(std::size_t bytes)
+{
+  retentionState().memoryLimit = bytes;
+
+  enforceLimit();
+}
+
+
+std::size_t
+DataRetention::
+diskLimit()
+{
+  return retentionState().diskLimit;
+}
+
+
+void
+DataRetention::
+setDiskLimit(std::size_t bytes)
+{
+  retentionState().diskLimit = bytes;
+}
+
+
+QString
+DataRetention::
+spillDirectory()
+{
+  return retentionState().spillDirectory;
+}
+
+
+void
+DataRetention::
+setSpillDirectory(QString const& directory)
+{
+  retentionState().spillDirectory = directory;
+}
+
+
+std::size_t
+DataRetention::
+residentBytes()
+{
+  return retentionState().residentBytes;
+}
+
+
+std::size_t
+DataRetention::
+spilledBytes()
+{
+  return retentionState().spilledBytes;
+}
+
+
+std::size_t
+DataRetention::
+trim(std::size_t residentBytes)
+{
+  auto &state = retentionState();
+
+  std::size_t released = 0;
+
+  for (auto it = state.order.rbegin();
+       it != state.order.rend() && state.residentBytes > residentBytes;
+       ++it)
+  {
+    Payload &payload = state.payloads[*it];
+
+    std::size_t const bytes = payload.bytes;
+
+    if (spill(payload))
+      released += bytes;
+  }
+
+  return released;
+}
+
+
+std::size_t
+DataRetention::
+release(std::unordered_set<NodeData const*> const& payloads,
+        std::size_t bytes)
+{
+  auto &state = retentionState();
+
+  std::size_t released = 0;
+
+  for (auto it = state.order.rbegin();
+       it != state.order.rend() && released < bytes;
+       ++it)
+  {
+    if (!payloads.count(*it))
+      continue;
+
+    Payload &payload = state.payloads[*it];
+
+    std::size_t const payloadBytes = payload.bytes;
+
+    if (spill(payload))
+      released += payloadBytes;
+  }
+
+  return released;
+}
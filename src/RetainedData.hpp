@@ -0,0 +1,138 @@
+#pragma once
+
+#include <memory>
+#include <cstddef>
+#include <unordered_set>
+
+#include <QtCore/QString>
+
+#include "NodeData.hpp"
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+struct RetentionEntry;
+
+/// Holder for data a model keeps between computations, typically
+/// its last output. Instead of
+///
+///   std::shared_ptr<NodeData> _result;
+///
+/// a model stores `RetainedData _result;` and returns `_result.get()`
+/// from outData(). When DataRetention's memory limit is exceeded the
+/// least recently used payloads are written to a spill file and read
+/// back transparently on the next get(). Only payloads implementing
+/// NodeData::spillPayload() are spilled, and only while the holder is
+/// their sole owner, so data still referenced downstream or shown by
+/// a widget stays in memory. Must only be used from the GUI thread.
+class NODE_EDITOR_PUBLIC RetainedData
+{
+public:
+
+  RetainedData();
+
+  RetainedData(std::shared_ptr<NodeData> data);
+
+  ~RetainedData();
+
+  RetainedData(RetainedData const&) = delete;
+  RetainedData& operator=(RetainedData const&) = delete;
+
+  RetainedData&
+  operator=(std::shared_ptr<NodeData> data);
+
+public:
+
+  /// The payload, read back from the spill file if necessary.
+  /// Counts as a use for the LRU order.
+  std::shared_ptr<NodeData>
+  get();
+
+  template<typename T>
+  std::shared_ptr<T>
+  get() { return std::dynamic_pointer_cast<T>(get()); }
+
+  void
+  reset();
+
+  bool
+  isNull() const;
+
+  bool
+  isSpilled() const;
+
+  /// A pinned payload is never spilled, e.g. while a widget shows it
+  void
+  setPinned(bool pinned);
+
+private:
+
+  std::unique_ptr<RetentionEntry> _entry;
+};
+
+
+/// Limits of the process-wide RetainedData store
+class NODE_EDITOR_PUBLIC DataRetention
+{
+public:
+
+  /// Resident bytes of all RetainedData above which the least
+  /// recently used payloads are spilled. 0, the default, never spills.
+  static
+  std::size_t
+  memoryLimit();
+
+  static
+  void
+  setMemoryLimit(std::size_t bytes);
+
+  /// Size the spill file may not grow beyond; payloads that do not
+  /// fit stay in memory. 0, the default, means no limit. The space of
+  /// payloads read back or released is reclaimed once it exceeds the
+  /// space of those still spilled.
+  static
+  std::size_t
+  diskLimit();
+
+  static
+  void
+  setDiskLimit(std::size_t bytes);
+
+  /// Directory of the spill file, the system temporary directory
+  /// by default. Applies to the next spill file created.
+  static
+  QString
+  spillDirectory();
+
+  static
+  void
+  setSpillDirectory(QString const& directory);
+
+  static
+  std::size_t
+  residentBytes();
+
+  static
+  std::size_t
+  spilledBytes();
+
+  /// Spills least recently used payloads until at most
+  /// `residentBytes` remain in memory. Returns the bytes released.
+  static
+  std::size_t
+  trim(std::size_t residentBytes);
+
+  /// Spills least recently used payloads among `payloads` until
+  /// `bytes` are released, other payloads stay resident, e.g. those
+  /// of other scenes. Returns the bytes released.
+  static
+  std::size_t
+  release(std::unordered_set<NodeData const*> const& payloads,
+          std::size_t bytes);
+
+private:
+
+  DataRetention() = delete;
+};
+}
@@ -0,0 +1,700 @@
+#include "SceneExporter.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QXmlStreamWriter>
+#include <QtGui/QFontDatabase>
+#include <QtGui/QFontInfo>
+#include <QtGui/QFontMetricsF>
+#include <QtGui/QLinearGradient>
+#include <QtGui/QPainter>
+#include <QtGui/QPainterPath>
+
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeGeometry.hpp"
+#include "NodeState.hpp"
+#include "NodeDataModel.hpp"
+#include "NodePortTable.hpp"
+#include "NodeGraphicsObject.hpp"
+#include "Connection.hpp"
+#include "ConnectionGeometry.hpp"
+#include "ConnectionGraphicsObject.hpp"
+#include "StyleCollection.hpp"
+
+using QtNodes::SceneExporter;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::NodeGeometry;
+using QtNodes::NodeState;
+using QtNodes::NodeDataModel;
+using QtNodes::NodePortTable;
+using QtNodes::NodeValidationState;
+using QtNodes::Connection;
+using QtNodes::ConnectionGeometry;
+using QtNodes::PortType;
+using QtNodes::StyleCollection;
+
+namespace
+{
+
+class TileJob : public QRunnable
+{
+public:
+
+  TileJob(std::function<void()> job)
+    : _job(std::move(job))
+  {}
+
+  void
+  run() override { _job(); }
+
+private:
+
+  std::function<void()> _job;
+};
+
+
+QString
+svgColor(QColor const &c)
+{
+  return c.name(QColor::HexRgb);
+}
+
+
+QString
+svgNumber(double v)
+{
+  return QString::number(v, 'f', 2);
+}
+}
+
+SceneExporter::
+SceneExporter(FlowScene const& scene)
+  : _font(scene.font())
+  , _boldFont(scene.font())
+  , _backgroundColor(StyleCollection::flowViewStyle().BackgroundColor)
+  , _tileSize(512)
+  , _threadCount(std::max(1, QThread::idealThreadCount()))
+  , _maxImagePixels(qint64(8192) * 8192)
+{
+  _boldFont.setBold(true);
+  _textHeight = QFontMetricsF(_font).height();
+
+  auto const &nodeStyle       = StyleCollection::nodeStyle();
+  auto const &connectionStyle = StyleCollection::connectionStyle();
+
+  _gradientColor0 = nodeStyle.GradientColor0;
+  _gradientColor1 = nodeStyle.GradientColor1;
+  _gradientColor2 = nodeStyle.GradientColor2;
+  _gradientColor3 = nodeStyle.GradientColor3;
+  _fontColor      = nodeStyle.FontColor;
+
+  _connectionWidth = connectionStyle.lineWidth();
+
+  double const diam = nodeStyle.ConnectionPointDiameter;
+
+  _nodes.reserve(scene.nodes().size());
+
+  for (auto const &entry : scene.nodes())
+  {
+    Node const &node = *entry.second;
+
+    // collapsed nodes are exported as their group
+    if (node.group())
+      continue;
+
+    NodeGeometry const &geom  = node.nodeGeometry();
+    NodeState const &state    = node.nodeState();
+    NodePortTable const &ports = node.portTable();
+    NodeDataModel const *model = node.nodeDataModel();
+
+    QTransform const t = node.nodeGraphicsObject().sceneTransform();
+
+    NodeShape shape;
+
+    shape.body = t.mapRect(QRectF(-diam, -diam,
+                                  2.0 * diam + geom.width(),
+                                  2.0 * diam + geom.height()));
+
+    shape.bounds = shape.body.adjusted(-diam, -diam, diam, diam);
+
+    shape.boundaryColor = node.nodeGraphicsObject().isSelected()
+                          ? nodeStyle.SelectedBoundaryColor
+                          : nodeStyle.NormalBoundaryColor;
+    shape.penWidth = nodeStyle.PenWidth;
+
+    if (model->captionVisible())
+    {
+      shape.caption = model->caption();
+      shape.captionPosition =
+        t.map(QPointF((geom.width() - geom.captionText().size().width()) / 2.0,
+                      (geom.spacing() + geom.entryHeight()) / 3.0));
+    }
+
+    auto const validationState = model->validationState();
+
+    if (validationState != NodeValidationState::Valid)
+    {
+      shape.validationColor = (validationState == NodeValidationState::Error)
+                              ? nodeStyle.ErrorColor
+                              : nodeStyle.WarningColor;
+
+      shape.validationRect =
+        t.mapRect(QRectF(-diam,
+                         -diam + geom.height() - geom.validationHeight(),
+                         2.0 * diam + geom.width(),
+                         2.0 * diam + geom.validationHeight()));
+    }
+
+    for (PortType portType : { PortType::In, PortType::Out })
+    {
+      auto const &entries = state.getEntries(portType);
+
+      for (std::size_t i = 0; i < entries.size(); ++i)
+      {
+        auto const &port = ports.port(portType, i);
+
+        bool const connected = !entries[i].empty();
+
+        PortShape p;
+
+        QPointF const local = geom.portScenePosition(i, portType);
+
+        p.position = t.map(local);
+        p.radius   = connected ? diam * 0.4 : diam * 0.6;
+
+        if (connectionStyle.useDataDefinedColors())
+          p.color = connectionStyle.normalColor(port.typeId);
+        else
+          p.color = connected
+                    ? nodeStyle.FilledConnectionPointColor
+                    : nodeStyle.ConnectionPointColor;
+
+        p.label      = port.label;
+        p.labelColor = connected ? nodeStyle.FontColor : nodeStyle.FontColorFaded;
+
+        double const x = (portType == PortType::In)
+                         ? 5.0
+                         : geom.width() - 5.0 - port.labelWidth;
+
+        p.labelPosition = t.map(QPointF(x, local.y() + geom.entryHeight() / 4.0));
+
+        shape.ports.push_back(std::move(p));
+      }
+    }
+
+    _sceneRect |= shape.bounds;
+
+    _nodes.push_back(std::move(shape));
+  }
+
+  _connections.reserve(scene.connections().size());
+
+  for (auto const &entry : scene.connections())
+  {
+    Connection const &connection = *entry.second;
+
+    // connections being dragged have no second end yet, and
+    // connections inside a collapsed group are not drawn
+    if (connection.connectionState().requiresPort() ||
+        connection.isCollapsed())
+      continue;
+
+    QTransform const t =
+      connection.getConnectionGraphicsObject().sceneTransform();
+
+    ConnectionGeometry const &local = connection.connectionGeometry();
+
+    ConnectionGeometry geom;
+    geom.setEndPoint(PortType::Out, t.map(local.source()));
+    geom.setEndPoint(PortType::In,  t.map(local.sink()));
+
+    auto const c1c2 = geom.pointsC1C2();
+
+    ConnectionShape shape;
+
+    shape.source = geom.source();
+    shape.c1     = c1c2.first;
+    shape.c2     = c1c2.second;
+    shape.sink   = geom.sink();
+
+    shape.color = connectionStyle.useDataDefinedColors()
+                  ? connectionStyle.normalColor(connection.typeId())
+                  : connectionStyle.normalColor();
+
+    // a cubic curve lies inside the hull of its control points
+    QRectF const hull = QRectF(shape.source, shape.sink).normalized() |
+                        QRectF(shape.c1, shape.c2).normalized();
+
+    double const m = _connectionWidth;
+
+    shape.bounds = hull.adjusted(-m, -m, m, m);
+
+    _sceneRect |= shape.bounds;
+
+    _connections.push_back(std::move(shape));
+  }
+
+  double const margin = 20.0;
+
+  _sceneRect.adjust(-margin, -margin, margin, margin);
+}
+
+
+QSize
+SceneExporter::
+imageSize(double scale) const
+{
+  return QSize(int(std::ceil(_sceneRect.width() * scale)),
+               int(std::ceil(_sceneRect.height() * scale)));
+}
+
+
+void
+SceneExporter::
+setTileSize(int size)
+{
+  _tileSize = std::max(16, size);
+}
+
+
+void
+SceneExporter::
+setThreadCount(int count)
+{
+  _threadCount = std::max(1, count);
+}
+
+
+void
+SceneExporter::
+setMaxImagePixels(qint64 pixels)
+{
+  _maxImagePixels = std::max<qint64>(1, pixels);
+}
+
+
+bool
+SceneExporter::
+renderTiles(double scale, TileSink const& sink) const
+{
+  QSize const size = imageSize(scale);
+
+  if (size.isEmpty())
+    return false;
+
+  int const columns = (size.width()  + _tileSize - 1) / _tileSize;
+  int const rows    = (size.height() + _tileSize - 1) / _tileSize;
+  int const nTiles  = columns * rows;
+
+  // glyph rasterization off the GUI thread is not available everywhere
+  bool const threaded = _threadCount > 1 &&
+                        QFontDatabase::supportsThreadedFontRendering();
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(_threadCount);
+
+  // at most this many tiles are alive at once
+  int const batchSize = threaded ? 2 * _threadCount : 1;
+
+  std::vector<QImage> images;
+  std::vector<QPoint> origins;
+
+  for (int first = 0; first < nTiles; first += batchSize)
+  {
+    int const last = std::min(first + batchSize, nTiles);
+
+    images.clear();
+    origins.clear();
+
+    QRect batchRect;
+
+    for (int tile = first; tile < last; ++tile)
+    {
+      QPoint const origin((tile % columns) * _tileSize,
+                          (tile / columns) * _tileSize);
+
+      QSize const tileSize(std::min(_tileSize, size.width()  - origin.x()),
+                           std::min(_tileSize, size.height() - origin.y()));
+
+      images.emplace_back(tileSize, QImage::Format_ARGB32_Premultiplied);
+      origins.push_back(origin);
+
+      batchRect |= QRect(origin, tileSize);
+    }
+
+    // one spatial query for the whole batch instead of one per tile
+    QRectF const batchSceneRect(_sceneRect.topLeft() + QPointF(batchRect.topLeft()) / scale,
+                                QSizeF(batchRect.size()) / scale);
+
+    Selection const selection = select(batchSceneRect);
+
+    for (std::size_t i = 0; i < images.size(); ++i)
+    {
+      QImage &image       = images[i];
+      QPoint const origin = origins[i];
+
+      auto job = [this, &image, origin, scale, &selection]()
+                 { renderTile(image, origin, scale, selection); };
+
+      if (threaded)
+        pool.start(new TileJob(job));
+      else
+        job();
+    }
+
+    pool.waitForDone();
+
+    for (std::size_t i = 0; i < images.size(); ++i)
+    {
+      if (!sink(origins[i], images[i]))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+QImage
+SceneExporter::
+renderImage(double scale) const
+{
+  QSize const size = imageSize(scale);
+
+  if (size.isEmpty())
+    return QImage();
+
+  if (qint64(size.width()) * size.height() > _maxImagePixels)
+  {
+    qWarning() << "Scene image of" << size << "exceeds the limit of"
+               << _maxImagePixels << "pixels, use exportTiles()";
+    return QImage();
+  }
+
+  QImage result(size, QImage::Format_ARGB32_Premultiplied);
+
+  if (result.isNull())
+  {
+    qWarning() << "Could not allocate a scene image of" << size;
+    return result;
+  }
+
+  {
+    QPainter painter(&result);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    if (!renderTiles(scale,
+                     [&painter](QPoint const& offset, QImage const& tile)
+                     {
+                       painter.drawImage(offset, tile);
+                       return true;
+                     }))
+      return QImage();
+  }
+
+  return result;
+}
+
+
+QImage
+SceneExporter::
+thumbnail(QSize const& maxSize) const
+{
+  if (_sceneRect.isEmpty() || maxSize.isEmpty())
+    return QImage();
+
+  double const scale = std::min(maxSize.width()  / _sceneRect.width(),
+                                maxSize.height() / _sceneRect.height());
+
+  return renderImage(scale);
+}
+
+
+bool
+SceneExporter::
+exportPng(QString const& fileName, double scale) const
+{
+  QImage const image = renderImage(scale);
+
+  return !image.isNull() && image.save(fileName, "PNG");
+}
+
+
+bool
+SceneExporter::
+exportTiles(QString const& directory, double scale) const
+{
+  QDir dir(directory);
+
+  if (!dir.exists() && !dir.mkpath(QStringLiteral(".")))
+    return false;
+
+  int const tileSize = _tileSize;
+
+  return renderTiles(scale,
+                     [&dir, tileSize](QPoint const& offset, QImage const& tile)
+                     {
+                       QString const name = QStringLiteral("tile_%1_%2.png")
+                                            .arg(offset.y() / tileSize)
+                                            .arg(offset.x() / tileSize);
+
+                       return tile.save(dir.filePath(name), "PNG");
+                     });
+}
+
+
+bool
+SceneExporter::
+exportSvg(QString const& fileName) const
+{
+  QFile file(fileName);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return false;
+
+  QXmlStreamWriter xml(&file);
+  xml.setAutoFormatting(true);
+
+  xml.writeStartDocument();
+
+  xml.writeStartElement(QStringLiteral("svg"));
+  xml.writeDefaultNamespace(QStringLiteral("http://www.w3.org/2000/svg"));
+  xml.writeAttribute(QStringLiteral("width"),  svgNumber(_sceneRect.width()));
+  xml.writeAttribute(QStringLiteral("height"), svgNumber(_sceneRect.height()));
+  xml.writeAttribute(QStringLiteral("viewBox"),
+                     QStringLiteral("%1 %2 %3 %4")
+                     .arg(svgNumber(_sceneRect.left()))
+                     .arg(svgNumber(_sceneRect.top()))
+                     .arg(svgNumber(_sceneRect.width()))
+                     .arg(svgNumber(_sceneRect.height())));
+
+  xml.writeStartElement(QStringLiteral("defs"));
+  xml.writeStartElement(QStringLiteral("linearGradient"));
+  xml.writeAttribute(QStringLiteral("id"), QStringLiteral("body"));
+  xml.writeAttribute(QStringLiteral("x2"), QStringLiteral("0"));
+  xml.writeAttribute(QStringLiteral("y2"), QStringLiteral("1"));
+
+  auto stop =
+    [&xml](double offset, QColor const &color)
+    {
+      xml.writeEmptyElement(QStringLiteral("stop"));
+      xml.writeAttribute(QStringLiteral("offset"), QString::number(offset));
+      xml.writeAttribute(QStringLiteral("stop-color"), svgColor(color));
+    };
+
+  stop(0.0,  _gradientColor0);
+  stop(0.03, _gradientColor1);
+  stop(0.97, _gradientColor2);
+  stop(1.0,  _gradientColor3);
+
+  xml.writeEndElement(); // linearGradient
+  xml.writeEndElement(); // defs
+
+  xml.writeEmptyElement(QStringLiteral("rect"));
+  xml.writeAttribute(QStringLiteral("x"),      svgNumber(_sceneRect.left()));
+  xml.writeAttribute(QStringLiteral("y"),      svgNumber(_sceneRect.top()));
+  xml.writeAttribute(QStringLiteral("width"),  svgNumber(_sceneRect.width()));
+  xml.writeAttribute(QStringLiteral("height"), svgNumber(_sceneRect.height()));
+  xml.writeAttribute(QStringLiteral("fill"),   svgColor(_backgroundColor));
+
+  for (auto const &c : _connections)
+  {
+    xml.writeEmptyElement(QStringLiteral("path"));
+    xml.writeAttribute(QStringLiteral("d"),
+                       QStringLiteral("M%1 %2 C%3 %4 %5 %6 %7 %8")
+                       .arg(svgNumber(c.source.x())).arg(svgNumber(c.source.y()))
+                       .arg(svgNumber(c.c1.x())).arg(svgNumber(c.c1.y()))
+                       .arg(svgNumber(c.c2.x())).arg(svgNumber(c.c2.y()))
+                       .arg(svgNumber(c.sink.x())).arg(svgNumber(c.sink.y())));
+    xml.writeAttribute(QStringLiteral("fill"), QStringLiteral("none"));
+    xml.writeAttribute(QStringLiteral("stroke"), svgColor(c.color));
+    xml.writeAttribute(QStringLiteral("stroke-width"), svgNumber(_connectionWidth));
+  }
+
+  auto text =
+    [&xml](QPointF const &p, QString const &s, QColor const &color, bool bold)
+    {
+      xml.writeStartElement(QStringLiteral("text"));
+      xml.writeAttribute(QStringLiteral("x"), svgNumber(p.x()));
+      xml.writeAttribute(QStringLiteral("y"), svgNumber(p.y()));
+      xml.writeAttribute(QStringLiteral("fill"), svgColor(color));
+
+      if (bold)
+        xml.writeAttribute(QStringLiteral("font-weight"), QStringLiteral("bold"));
+
+      xml.writeCharacters(s);
+      xml.writeEndElement();
+    };
+
+  for (auto const &n : _nodes)
+  {
+    xml.writeStartElement(QStringLiteral("g"));
+    xml.writeAttribute(QStringLiteral("font-family"), _font.family());
+    xml.writeAttribute(QStringLiteral("font-size"),
+                       svgNumber(QFontInfo(_font).pixelSize()));
+
+    xml.writeEmptyElement(QStringLiteral("rect"));
+    xml.writeAttribute(QStringLiteral("x"),      svgNumber(n.body.left()));
+    xml.writeAttribute(QStringLiteral("y"),      svgNumber(n.body.top()));
+    xml.writeAttribute(QStringLiteral("width"),  svgNumber(n.body.width()));
+    xml.writeAttribute(QStringLiteral("height"), svgNumber(n.body.height()));
+    xml.writeAttribute(QStringLiteral("rx"),     QStringLiteral("3"));
+    xml.writeAttribute(QStringLiteral("fill"),   QStringLiteral("url(#body)"));
+    xml.writeAttribute(QStringLiteral("stroke"), svgColor(n.boundaryColor));
+    xml.writeAttribute(QStringLiteral("stroke-width"), svgNumber(n.penWidth));
+
+    if (n.validationColor.isValid())
+    {
+      xml.writeEmptyElement(QStringLiteral("rect"));
+      xml.writeAttribute(QStringLiteral("x"),      svgNumber(n.validationRect.left()));
+      xml.writeAttribute(QStringLiteral("y"),      svgNumber(n.validationRect.top()));
+      xml.writeAttribute(QStringLiteral("width"),  svgNumber(n.validationRect.width()));
+      xml.writeAttribute(QStringLiteral("height"), svgNumber(n.validationRect.height()));
+      xml.writeAttribute(QStringLiteral("rx"),     QStringLiteral("3"));
+      xml.writeAttribute(QStringLiteral("fill"),   svgColor(n.validationColor));
+    }
+
+    for (auto const &p : n.ports)
+    {
+      xml.writeEmptyElement(QStringLiteral("circle"));
+      xml.writeAttribute(QStringLiteral("cx"),   svgNumber(p.position.x()));
+      xml.writeAttribute(QStringLiteral("cy"),   svgNumber(p.position.y()));
+      xml.writeAttribute(QStringLiteral("r"),    svgNumber(p.radius));
+      xml.writeAttribute(QStringLiteral("fill"), svgColor(p.color));
+
+      if (!p.label.isEmpty())
+        text(p.labelPosition, p.label, p.labelColor, false);
+    }
+
+    if (!n.caption.isEmpty())
+      text(n.captionPosition, n.caption, _fontColor, true);
+
+    xml.writeEndElement(); // g
+  }
+
+  xml.writeEndElement(); // svg
+  xml.writeEndDocument();
+
+  return !xml.hasError();
+}
+
+
+SceneExporter::Selection
+SceneExporter::
+select(QRectF const& rect) const
+{
+  Selection result;
+
+  for (std::size_t i = 0; i < _nodes.size(); ++i)
+  {
+    if (_nodes[i].bounds.intersects(rect))
+      result.nodes.push_back(i);
+  }
+
+  for (std::size_t i = 0; i < _connections.size(); ++i)
+  {
+    if (_connections[i].bounds.intersects(rect))
+      result.connections.push_back(i);
+  }
+
+  return result;
+}
+
+
+void
+SceneExporter::
+renderTile(QImage &image,
+           QPoint const& origin,
+           double scale,
+           Selection const& selection) const
+{
+  image.fill(_backgroundColor);
+
+  QPainter painter(&image);
+  painter.setRenderHint(QPainter::Antialiasing);
+
+  painter.translate(-QPointF(origin));
+  painter.scale(scale, scale);
+  painter.translate(-_sceneRect.topLeft());
+
+  QRectF const tileRect(_sceneRect.topLeft() + QPointF(origin) / scale,
+                        QSizeF(image.size()) / scale);
+
+  painter.setBrush(Qt::NoBrush);
+
+  for (std::size_t i : selection.connections)
+  {
+    ConnectionShape const &c = _connections[i];
+
+    if (!c.bounds.intersects(tileRect))
+      continue;
+
+    QPainterPath cubic(c.source);
+    cubic.cubicTo(c.c1, c.c2, c.sink);
+
+    painter.setPen(QPen(c.color, _connectionWidth));
+    painter.drawPath(cubic);
+  }
+
+  bool const drawText = _textHeight * scale >= 4.0;
+
+  for (std::size_t i : selection.nodes)
+  {
+    NodeShape const &n = _nodes[i];
+
+    if (!n.bounds.intersects(tileRect))
+      continue;
+
+    QLinearGradient gradient(n.body.topLeft(), n.body.bottomLeft());
+
+    gradient.setColorAt(0.0,  _gradientColor0);
+    gradient.setColorAt(0.03, _gradientColor1);
+    gradient.setColorAt(0.97, _gradientColor2);
+    gradient.setColorAt(1.0,  _gradientColor3);
+
+    painter.setPen(QPen(n.boundaryColor, n.penWidth));
+    painter.setBrush(gradient);
+    painter.drawRoundedRect(n.body, 3.0, 3.0);
+
+    if (n.validationColor.isValid())
+    {
+      painter.setBrush(n.validationColor);
+      painter.drawRoundedRect(n.validationRect, 3.0, 3.0);
+    }
+
+    painter.setPen(Qt::NoPen);
+
+    for (auto const &p : n.ports)
+    {
+      painter.setBrush(p.color);
+      painter.drawEllipse(p.position, p.radius, p.radius);
+    }
+
+    if (!drawText)
+      continue;
+
+    painter.setFont(_font);
+
+    for (auto const &p : n.ports)
+    {
+      painter.setPen(p.labelColor);
+      painter.drawText(p.labelPosition, p.label);
+    }
+
+    if (!n.caption.isEmpty())
+    {
+      painter.setFont(_boldFont);
+      painter.setPen(_fontColor);
+      painter.drawText(n.captionPosition, n.caption);
+    }
+  }
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include <QtCore/QRectF>
+#include <QtCore/QString>
+#include <QtGui/QColor>
+#include <QtGui/QFont>
+#include <QtGui/QImage>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class FlowScene;
+
+/// Renders a FlowScene to images or SVG without the graphics items.
+///
+/// The constructor takes a snapshot of node and connection geometry on
+/// the GUI thread; rendering afterwards only reads the snapshot, so the
+/// image is split into tiles that are rasterized by worker threads.
+/// `renderTiles` hands tiles out in small batches, memory stays bounded
+/// by `threadCount() * tileSize()` regardless of the output size.
+class NODE_EDITOR_PUBLIC SceneExporter
+{
+public:
+
+  /// Receives tiles in row-major order on the calling thread.
+  /// `offset` is the tile position inside the whole image.
+  /// Returning false cancels the export.
+  using TileSink = std::function<bool(QPoint const& offset,
+                                      QImage const& tile)>;
+
+  explicit
+  SceneExporter(FlowScene const& scene);
+
+public:
+
+  /// Bounding rect of all nodes and connections in scene coordinates
+  QRectF
+  sceneRect() const { return _sceneRect; }
+
+  /// Size of the image produced for `scale` pixels per scene unit
+  QSize
+  imageSize(double scale) const;
+
+  int
+  tileSize() const { return _tileSize; }
+
+  void
+  setTileSize(int size);
+
+  /// Number of worker threads, defaults to QThread::idealThreadCount()
+  int
+  threadCount() const { return _threadCount; }
+
+  void
+  setThreadCount(int count);
+
+  /// Largest image `renderImage` and `exportPng` allocate, in pixels.
+  /// Defaults to 8192 x 8192, i.e. 256 MiB at 32 bits per pixel.
+  qint64
+  maxImagePixels() const { return _maxImagePixels; }
+
+  void
+  setMaxImagePixels(qint64 pixels);
+
+  QColor const &
+  backgroundColor() const { return _backgroundColor; }
+
+  void
+  setBackgroundColor(QColor const &color) { _backgroundColor = color; }
+
+public:
+
+  bool
+  renderTiles(double scale, TileSink const& sink) const;
+
+  /// Stitches all tiles into one image held in memory. Returns a null
+  /// image and warns if it would exceed `maxImagePixels()` or cannot be
+  /// allocated; use `exportTiles` for larger exports.
+  QImage
+  renderImage(double scale) const;
+
+  /// Image scaled down to fit into `maxSize`
+  QImage
+  thumbnail(QSize const& maxSize) const;
+
+  /// Goes through `renderImage`, so it fails above `maxImagePixels()`
+  bool
+  exportPng(QString const& fileName, double scale = 1.0) const;
+
+  /// Streams tiles to `<directory>/tile_<row>_<column>.png`
+  bool
+  exportTiles(QString const& directory, double scale = 1.0) const;
+
+  bool
+  exportSvg(QString const& fileName) const;
+
+private:
+
+  struct PortShape
+  {
+    QPointF position;
+    double  radius;
+    QColor  color;
+
+    QPointF labelPosition;
+    QString label;
+    QColor  labelColor;
+  };
+
+  struct NodeShape
+  {
+    QRectF bounds;
+    QRectF body;
+
+    QColor boundaryColor;
+    double penWidth;
+
+    QString caption;
+    QPointF captionPosition;
+
+    /// Invalid if the node has no validation message
+    QColor validationColor;
+    QRectF validationRect;
+
+    std::vector<PortShape> ports;
+  };
+
+  struct ConnectionShape
+  {
+    QRectF bounds;
+
+    QPointF source;
+    QPointF c1;
+    QPointF c2;
+    QPointF sink;
+
+    QColor color;
+  };
+
+  /// Indices of the shapes intersecting `rect`
+  struct Selection
+  {
+    std::vector<std::size_t> nodes;
+    std::vector<std::size_t> connections;
+  };
+
+  Selection
+  select(QRectF const& rect) const;
+
+  /// Paints the selected shapes into `image`, which shows the part of
+  /// the scene starting at `origin` pixels of the full image
+  void
+  renderTile(QImage &image,
+             QPoint const& origin,
+             double scale,
+             Selection const& selection) const;
+
+private:
+
+  std::vector<NodeShape>       _nodes;
+  std::vector<ConnectionShape> _connections;
+
+  QRectF _sceneRect;
+
+  QFont _font;
+  QFont _boldFont;
+
+  /// Text is skipped when it would be smaller than a few pixels
+  double _textHeight;
+
+  QColor _gradientColor0;
+  QColor _gradientColor1;
+  QColor _gradientColor2;
+  QColor _gradientColor3;
+  QColor _fontColor;
+
+  double _connectionWidth;
+
+  QColor _backgroundColor;
+
+  int _tileSize;
+  int _threadCount;
+
+  qint64 _maxImagePixels;
+};
+}
@@ -0,0 +1,893 @@
+#include "SceneJournal.hpp"
+
+#include <algorithm>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QPointer>
+#include <QtCore/QTimer>
+#include <QtWidgets/QUndoStack>
+
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeDataModel.hpp"
+#include "NodeGraphicsObject.hpp"
+#include "Connection.hpp"
+
+using QtNodes::SceneJournal;
+using QtNodes::SceneJournalCommand;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::NodeDataModel;
+using QtNodes::Connection;
+using QtNodes::ConnectionDescription;
+using QtNodes::PortType;
+using QtNodes::PortIndex;
+
+namespace
+{
+
+/// QUndoCommand::id() of journal commands, enables merging
+int const commandId = 0x4e4a;
+
+/// Drag steps further apart than this start a new command
+qint64 const dragMergeInterval = 500;
+
+int const defaultUndoLimit = 200;
+
+std::size_t const defaultMaxCommandBytes = 64 * 1024 * 1024;
+
+std::size_t const defaultMaxJournalBytes = 256 * 1024 * 1024;
+
+
+SceneJournal::ConnectionKey
+keyOf(Connection const& connection)
+{
+  SceneJournal::ConnectionKey key;
+
+  if (Node const* out = connection.getNode(PortType::Out))
+  {
+    key.outNode = out->id();
+    key.outPort = connection.getPortIndex(PortType::Out);
+  }
+
+  if (Node const* in = connection.getNode(PortType::In))
+  {
+    key.inNode = in->id();
+    key.inPort = connection.getPortIndex(PortType::In);
+  }
+
+  return key;
+}
+
+
+QByteArray
+compactJson(QJsonObject const& json)
+{
+  return QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+
+QByteArray
+modelDelta(QJsonObject const& set, QJsonArray const& removed)
+{
+  QJsonObject delta;
+
+  delta["set"]     = set;
+  delta["removed"] = removed;
+
+  return compactJson(delta);
+}
+
+
+QString
+describe(SceneJournal::Record const& record)
+{
+  switch (record.kind)
+  {
+    case SceneJournal::Record::NodeCreated:
+      return QStringLiteral("Create Node");
+
+    case SceneJournal::Record::NodeRemoved:
+      return QStringLiteral("Delete Node");
+
+    case SceneJournal::Record::ConnectionCreated:
+      return QStringLiteral("Connect");
+
+    case SceneJournal::Record::ConnectionRemoved:
+      return QStringLiteral("Disconnect");
+
+    case SceneJournal::Record::NodesMoved:
+      return QStringLiteral("Move Nodes");
+
+    case SceneJournal::Record::ModelChanged:
+      return QStringLiteral("Edit Node");
+  }
+
+  return QString();
+}
+}
+
+namespace QtNodes
+{
+
+/// The records of one event loop iteration
+class SceneJournalCommand
+  : public QUndoCommand
+{
+public:
+
+  SceneJournalCommand(SceneJournal& journal)
+    : _journal(&journal)
+    , _bytes(0)
+    , _skipRedo(true)
+  {
+    _lastStep.start();
+  }
+
+  ~SceneJournalCommand()
+  {
+    if (!_journal)
+      return;
+
+    _journal->commandDestroyed(_bytes);
+
+    if (_journal->_current == this)
+      _journal->_current = nullptr;
+  }
+
+  void
+  append(SceneJournal::Record&& record, std::size_t bytes)
+  {
+    if (_records.empty())
+      setText(describe(record));
+
+    _records.push_back(std::move(record));
+
+    _bytes += bytes;
+  }
+
+  std::size_t
+  bytes() const { return _bytes; }
+
+  /// Frees the records, undo and redo do nothing from now on
+  void
+  expire()
+  {
+    if (_journal)
+      _journal->commandDestroyed(_bytes);
+
+    _records.clear();
+    _records.shrink_to_fit();
+
+    _bytes = 0;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+    // the stack deletes it when it is undone
+    setObsolete(true);
+#endif
+  }
+
+  void
+  undo() override
+  {
+    if (_journal)
+      _journal->apply(_records, true);
+  }
+
+  void
+  redo() override
+  {
+    // QUndoStack::push() redoes, but the edit has already happened
+    if (_skipRedo)
+    {
+      _skipRedo = false;
+      return;
+    }
+
+    if (_journal)
+      _journal->apply(_records, false);
+  }
+
+  int
+  id() const override { return commandId; }
+
+  bool
+  mergeWith(QUndoCommand const* other) override
+  {
+    auto next = static_cast<SceneJournalCommand const*>(other);
+
+    if (!isDragStep() || !next->isDragStep())
+      return false;
+
+    auto &move = _records.front();
+
+    if (move.nodes != next->_records.front().nodes ||
+        _lastStep.elapsed() > dragMergeInterval)
+      return false;
+
+    move.offset += next->_records.front().offset;
+
+    _lastStep.restart();
+
+    return true;
+  }
+
+private:
+
+  bool
+  isDragStep() const
+  {
+    return _records.size() == 1 &&
+           _records.front().kind == SceneJournal::Record::NodesMoved;
+  }
+
+private:
+
+  QPointer<SceneJournal> _journal;
+
+  std::vector<SceneJournal::Record> _records;
+
+  std::size_t _bytes;
+
+  bool _skipRedo;
+
+  QElapsedTimer _lastStep;
+};
+}
+
+std::size_t
+SceneJournal::Record::
+byteSize() const
+{
+  return sizeof(Record) + data.size() + redoData.size() +
+         nodes.size() * sizeof(QUuid);
+}
+
+
+SceneJournal::
+SceneJournal(FlowScene& scene, QUndoStack* stack, QObject* parent)
+  : QObject(parent)
+  , _scene(scene)
+  , _stack(stack)
+  , _maxCommandBytes(defaultMaxCommandBytes)
+  , _maxJournalBytes(defaultMaxJournalBytes)
+  , _journalBytes(0)
+  , _applying(false)
+  , _current(nullptr)
+  , _batchPending(false)
+  , _discardBatch(false)
+{
+  if (!_stack)
+  {
+    _stack = new QUndoStack(this);
+    _stack->setUndoLimit(defaultUndoLimit);
+  }
+
+  for (auto const &entry : _scene.nodes())
+  {
+    if (!entry.second->isGroup())
+      trackNode(*entry.second);
+  }
+
+  for (auto const &entry : _scene.connections())
+    trackConnection(*entry.second);
+
+  connect(&_scene, &FlowScene::nodeCreated,        this, &SceneJournal::onNodeCreated);
+  connect(&_scene, &FlowScene::nodesCreated,       this, &SceneJournal::onNodesCreated);
+  connect(&_scene, &FlowScene::nodeDeleted,        this, &SceneJournal::onNodeDeleted);
+  connect(&_scene, &FlowScene::nodeMoved,          this, &SceneJournal::onNodeMoved);
+  connect(&_scene, &FlowScene::nodesMoved,         this, &SceneJournal::onNodesMoved);
+  connect(&_scene, &FlowScene::connectionCreated,  this, &SceneJournal::onConnectionCreated);
+  connect(&_scene, &FlowScene::connectionsCreated, this, &SceneJournal::onConnectionsCreated);
+  connect(&_scene, &FlowScene::connectionDeleted,  this, &SceneJournal::onConnectionDeleted);
+  connect(&_scene, &FlowScene::nodesExpanded,      this, &SceneJournal::onNodesExpanded);
+}
+
+
+SceneJournal::
+~SceneJournal()
+{
+  _current = nullptr;
+}
+
+
+void
+SceneJournal::
+setMaxJournalBytes(std::size_t bytes)
+{
+  _maxJournalBytes = bytes;
+
+  expireOldCommands();
+}
+
+
+void
+SceneJournal::
+recordModelState(Node& node)
+{
+  auto it = _nodes.find(node.id());
+
+  if (it == _nodes.end())
+    return;
+
+  QJsonObject const state   = node.nodeDataModel()->save();
+  QJsonObject &     previous = it->second.state;
+
+  if (state == previous)
+    return;
+
+  if (_applying)
+  {
+    previous = state;
+    return;
+  }
+
+  QJsonObject undoSet, redoSet;
+  QJsonArray  undoRemoved, redoRemoved;
+
+  for (auto k = state.begin(); k != state.end(); ++k)
+  {
+    auto const old = previous.find(k.key());
+
+    if (old == previous.end())
+    {
+      redoSet.insert(k.key(), k.value());
+      undoRemoved.append(k.key());
+    }
+    else if (old.value() != k.value())
+    {
+      redoSet.insert(k.key(), k.value());
+      undoSet.insert(k.key(), old.value());
+    }
+  }
+
+  for (auto k = previous.begin(); k != previous.end(); ++k)
+  {
+    if (!state.contains(k.key()))
+    {
+      undoSet.insert(k.key(), k.value());
+      redoRemoved.append(k.key());
+    }
+  }
+
+  previous = state;
+
+  Record r;
+  r.kind     = Record::ModelChanged;
+  r.node     = node.id();
+  r.data     = modelDelta(undoSet, undoRemoved);
+  r.redoData = modelDelta(redoSet, redoRemoved);
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onNodeCreated(Node& node)
+{
+  // groups are a view of their nodes, which stay tracked
+  if (node.isGroup())
+    return;
+
+  trackNode(node);
+
+  if (_applying)
+    return;
+
+  Record r;
+  r.kind = Record::NodeCreated;
+  r.node = node.id();
+  r.data = compactJson(node.save());
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onNodesCreated(std::vector<Node*> const& nodes)
+{
+  for (Node* node : nodes)
+    onNodeCreated(*node);
+}
+
+
+void
+SceneJournal::
+onNodeDeleted(Node& node)
+{
+  if (node.isGroup())
+    return;
+
+  _nodes.erase(node.id());
+
+  if (_applying)
+    return;
+
+  Record r;
+  r.kind = Record::NodeRemoved;
+  r.node = node.id();
+  r.data = compactJson(node.save());
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onNodeMoved(Node& node, QPointF const& newLocation)
+{
+  auto it = _nodes.find(node.id());
+
+  if (it == _nodes.end())
+    return;
+
+  QPointF const offset = newLocation - it->second.position;
+
+  it->second.position = newLocation;
+
+  if (offset.isNull())
+    return;
+
+  Record r;
+  r.kind   = Record::NodesMoved;
+  r.nodes  = { node.id() };
+  r.offset = offset;
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onNodesMoved(std::vector<Node*> const& nodes, QPointF const& offset)
+{
+  Record r;
+  r.kind   = Record::NodesMoved;
+  r.offset = offset;
+
+  r.nodes.reserve(nodes.size());
+
+  for (Node* node : nodes)
+  {
+    auto it = _nodes.find(node->id());
+
+    if (it == _nodes.end())
+      continue;
+
+    it->second.position += offset;
+
+    r.nodes.push_back(node->id());
+  }
+
+  if (r.nodes.empty() || offset.isNull())
+    return;
+
+  // drag steps of the same selection compare equal
+  std::sort(r.nodes.begin(), r.nodes.end());
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onNodesExpanded(std::vector<Node*> const& nodes)
+{
+  // moving a group moves its nodes without recording
+  for (Node* node : nodes)
+  {
+    auto it = _nodes.find(node->id());
+
+    if (it != _nodes.end())
+      it->second.position = node->position();
+  }
+}
+
+
+void
+SceneJournal::
+onConnectionCreated(Connection& connection)
+{
+  trackConnection(connection);
+
+  ConnectionKey const key = _connections[&connection];
+
+  // a connection dragged out of a port is recorded once attached
+  if (!key.isComplete())
+    return;
+
+  Record r;
+  r.kind       = Record::ConnectionCreated;
+  r.connection = key;
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onConnectionsCreated(std::vector<Connection*> const& connections)
+{
+  for (Connection* connection : connections)
+    onConnectionCreated(*connection);
+}
+
+
+void
+SceneJournal::
+onConnectionDeleted(Connection& connection)
+{
+  auto it = _connections.find(&connection);
+
+  if (it == _connections.end())
+    return;
+
+  disconnect(&connection, nullptr, this, nullptr);
+
+  ConnectionKey const key = it->second;
+
+  _connections.erase(it);
+
+  if (!key.isComplete())
+    return;
+
+  Record r;
+  r.kind       = Record::ConnectionRemoved;
+  r.connection = key;
+
+  record(std::move(r));
+}
+
+
+void
+SceneJournal::
+onConnectionUpdated(Connection& connection)
+{
+  auto it = _connections.find(&connection);
+
+  if (it == _connections.end())
+    return;
+
+  ConnectionKey const key = keyOf(connection);
+
+  if (key == it->second)
+    return;
+
+  // attaching, detaching or moving an end of the connection
+  ConnectionKey const previous = it->second;
+
+  it->second = key;
+
+  if (previous.isComplete())
+  {
+    Record r;
+    r.kind       = Record::ConnectionRemoved;
+    r.connection = previous;
+
+    record(std::move(r));
+  }
+
+  if (key.isComplete())
+  {
+    Record r;
+    r.kind       = Record::ConnectionCreated;
+    r.connection = key;
+
+    record(std::move(r));
+  }
+}
+
+
+void
+SceneJournal::
+onModelUpdated(Node& node)
+{
+  // outputs recomputed from new inputs are not edits
+  if (node.isReceivingData())
+    return;
+
+  recordModelState(node);
+}
+
+
+void
+SceneJournal::
+trackNode(Node& node)
+{
+  _nodes[node.id()] = NodeSnapshot{ node.position(),
+                                    node.nodeDataModel()->save() };
+
+  Node* nodePtr = &node;
+
+  connect(node.nodeDataModel(), &NodeDataModel::dataUpdated, this,
+          [this, nodePtr](PortIndex)
+          {
+            onModelUpdated(*nodePtr);
+          });
+}
+
+
+void
+SceneJournal::
+trackConnection(Connection& connection)
+{
+  _connections[&connection] = keyOf(connection);
+
+  connect(&connection, &Connection::updated,
+          this, &SceneJournal::onConnectionUpdated);
+}
+
+
+void
+SceneJournal::
+record(Record&& record)
+{
+  if (_applying)
+    return;
+
+  if (!_batchPending)
+  {
+    _batchPending = true;
+
+    QTimer::singleShot(0, this,
+                       [this]()
+                       {
+                         _current      = nullptr;
+                         _batchPending = false;
+                         _discardBatch = false;
+                       });
+  }
+
+  if (_discardBatch)
+    return;
+
+  std::size_t const bytes = record.byteSize();
+
+  if ((_current ? _current->bytes() : 0) + bytes > _maxCommandBytes)
+  {
+    // too large to keep; earlier commands can't be replayed
+    // without it, so the history starts after this edit
+    _stack->clear();
+
+    _discardBatch = true;
+    return;
+  }
+
+  _journalBytes += bytes;
+
+  if (_current)
+  {
+    _current->append(std::move(record), bytes);
+
+    expireOldCommands();
+    return;
+  }
+
+  auto command = new SceneJournalCommand(*this);
+
+  command->append(std::move(record), bytes);
+
+  // the command may be merged into the previous one and deleted
+  _stack->push(command);
+
+  QUndoCommand const* top =
+    _stack->count() > 0 ? _stack->command(_stack->count() - 1) : nullptr;
+
+  _current = const_cast<SceneJournalCommand*>(
+    dynamic_cast<SceneJournalCommand const*>(top));
+
+  expireOldCommands();
+}
+
+
+void
+SceneJournal::
+expireOldCommands()
+{
+  // QUndoStack can't remove its oldest commands, they are emptied
+  // instead. Only commands below the stack index are expired: they
+  // are done, so undoing them to nothing keeps the scene consistent.
+  int const done = _stack->index();
+
+  for (int i = 0; i < done && _journalBytes > _maxJournalBytes; ++i)
+  {
+    auto command = const_cast<SceneJournalCommand*>(
+      dynamic_cast<SceneJournalCommand const*>(_stack->command(i)));
+
+    if (command && command != _current && command->bytes() > 0)
+      command->expire();
+  }
+}
+
+
+void
+SceneJournal::
+apply(std::vector<Record> const& records, bool undo)
+{
+  struct Step
+  {
+    Record const* record;
+    Record::Kind  kind;
+  };
+
+  std::vector<Step> steps;
+  steps.reserve(records.size());
+
+  auto inverse =
+    [](Record::Kind kind)
+    {
+      switch (kind)
+      {
+        case Record::NodeCreated:       return Record::NodeRemoved;
+        case Record::NodeRemoved:       return Record::NodeCreated;
+        case Record::ConnectionCreated: return Record::ConnectionRemoved;
+        case Record::ConnectionRemoved: return Record::ConnectionCreated;
+        default:                        return kind;
+      }
+    };
+
+  if (undo)
+  {
+    for (auto it = records.rbegin(); it != records.rend(); ++it)
+      steps.push_back({ &*it, inverse(it->kind) });
+  }
+  else
+  {
+    for (auto const &r : records)
+      steps.push_back({ &r, r.kind });
+  }
+
+  _applying = true;
+
+  // later edits must not join an undone or redone command
+  _current = nullptr;
+
+  // removals first and creations second, so that connections
+  // always find their nodes; moves and model changes come last
+
+  for (Step const &step : steps)
+  {
+    if (step.kind != Record::ConnectionRemoved)
+      continue;
+
+    if (Connection* c = findConnection(step.record->connection))
+      _scene.deleteConnection(*c);
+  }
+
+  std::vector<Node*> removed;
+
+  for (Step const &step : steps)
+  {
+    if (step.kind != Record::NodeRemoved)
+      continue;
+
+    if (Node* node = findNode(step.record->node))
+      removed.push_back(node);
+  }
+
+  if (!removed.empty())
+    _scene.removeNodes(removed);
+
+  for (Step const &step : steps)
+  {
+    if (step.kind != Record::NodeCreated || findNode(step.record->node))
+      continue;
+
+    _scene.restoreNode(QJsonDocument::fromJson(step.record->data).object());
+  }
+
+  std::vector<ConnectionDescription> connections;
+
+  for (Step const &step : steps)
+  {
+    if (step.kind != Record::ConnectionCreated)
+      continue;
+
+    ConnectionKey const &key = step.record->connection;
+
+    Node* nodeIn  = findNode(key.inNode);
+    Node* nodeOut = findNode(key.outNode);
+
+    if (nodeIn && nodeOut && !findConnection(key))
+      connections.push_back({ nodeIn, key.inPort, nodeOut, key.outPort });
+  }
+
+  if (!connections.empty())
+    _scene.createConnections(connections);
+
+  for (Step const &step : steps)
+  {
+    if (step.kind == Record::NodesMoved)
+    {
+      std::vector<Node*> nodes;
+
+      for (QUuid const &id : step.record->nodes)
+      {
+        if (Node* node = findNode(id))
+          nodes.push_back(node);
+      }
+
+      _scene.moveNodes(nodes, undo ? -step.record->offset : step.record->offset);
+    }
+    else if (step.kind == Record::ModelChanged)
+    {
+      if (Node* node = findNode(step.record->node))
+        restoreModelDelta(*node, undo ? step.record->data : step.record->redoData);
+    }
+  }
+
+  _applying = false;
+}
+
+
+Node*
+SceneJournal::
+findNode(QUuid const& id) const
+{
+  auto const &nodes = _scene.nodes();
+
+  auto it = nodes.find(id);
+
+  return it != nodes.end() ? it->second.get() : nullptr;
+}
+
+
+Connection*
+SceneJournal::
+findConnection(ConnectionKey const& key) const
+{
+  Node* node = findNode(key.outNode);
+
+  if (!node)
+    return nullptr;
+
+  auto const &entries = node->nodeState().getEntries(PortType::Out);
+
+  if (key.outPort < 0 || key.outPort >= static_cast<PortIndex>(entries.size()))
+    return nullptr;
+
+  for (auto const &pair : entries[key.outPort])
+  {
+    if (keyOf(*pair.second) == key)
+      return pair.second;
+  }
+
+  return nullptr;
+}
+
+
+void
+SceneJournal::
+restoreModelDelta(Node& node, QByteArray const& delta)
+{
+  QJsonObject const d = QJsonDocument::fromJson(delta).object();
+
+  NodeDataModel* model = node.nodeDataModel();
+
+  QJsonObject state = model->save();
+
+  for (QJsonValue const &key : d["removed"].toArray())
+    state.remove(key.toString());
+
+  QJsonObject const set = d["set"].toObject();
+
+  for (auto it = set.begin(); it != set.end(); ++it)
+    state.insert(it.key(), it.value());
+
+  model->restore(state);
+
+  _nodes[node.id()].state = model->save();
+
+  // restore() does not notify, recompute downstream like an edit does
+  unsigned int const nOut = model->nPorts(PortType::Out);
+
+  for (unsigned int i = 0; i < nOut; ++i)
+    node.onDataUpdated(static_cast<PortIndex>(i));
+
+  if (!node.group())
+    node.nodeGraphicsObject().update();
+}
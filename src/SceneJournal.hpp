@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <QtCore/QObject>
+#include <QtCore/QPointF>
+#include <QtCore/QJsonObject>
+#include <QtCore/QUuid>
+
+#include "PortType.hpp"
+#include "Connection.hpp"
+#include "Export.hpp"
+
+class QUndoStack;
+
+namespace QtNodes
+{
+
+class FlowScene;
+class Node;
+class Connection;
+class SceneJournalCommand;
+
+/// Records edits of a FlowScene as QUndoCommands.
+///
+/// The journal observes the scene signals and stores each change as a
+/// compact record: node JSON for created and removed nodes, port
+/// addresses for connections, offsets for moves and changed top level
+/// keys of NodeDataModel::save() for model state. All changes made in
+/// one event loop iteration form one command, consecutive drag steps
+/// of the same nodes are merged. Undo and redo replay only the
+/// records of a command.
+///
+/// Model state is compared when a model emits dataUpdated() on its
+/// own, not during propagation. Models changing state without that
+/// signal can call recordModelState().
+class NODE_EDITOR_PUBLIC SceneJournal
+  : public QObject
+{
+  Q_OBJECT
+
+public:
+
+  /// Pushes commands on `stack`, or on an own stack with
+  /// a limit of 200 commands if `stack` is null
+  SceneJournal(FlowScene& scene,
+               QUndoStack* stack = nullptr,
+               QObject* parent = nullptr);
+
+  ~SceneJournal();
+
+  SceneJournal(SceneJournal const&) = delete;
+  SceneJournal& operator=(SceneJournal const&) = delete;
+
+public:
+
+  QUndoStack*
+  undoStack() const { return _stack; }
+
+  FlowScene &
+  scene() const { return _scene; }
+
+  /// A command growing beyond this many bytes clears the stack, the
+  /// edit becomes the oldest state that can be restored
+  std::size_t
+  maxCommandBytes() const { return _maxCommandBytes; }
+
+  void
+  setMaxCommandBytes(std::size_t bytes) { _maxCommandBytes = bytes; }
+
+  /// Bytes all commands may hold together, 256 MiB by default. Beyond
+  /// it the oldest done commands are emptied and undo to nothing, the
+  /// command being recorded is always kept. Independent of the stack's
+  /// undo limit, so it also bounds a caller's unlimited stack.
+  std::size_t
+  maxJournalBytes() const { return _maxJournalBytes; }
+
+  void
+  setMaxJournalBytes(std::size_t bytes);
+
+  /// Bytes held by the journal's commands
+  std::size_t
+  journalBytes() const { return _journalBytes; }
+
+  /// True while a command is undone or redone
+  bool
+  isApplying() const { return _applying; }
+
+  /// Compares the model state of `node` with the last recorded one
+  void
+  recordModelState(Node& node);
+
+public:
+
+  /// Address of a connection that survives deleting and restoring
+  /// its nodes. Incomplete if one end is not attached.
+  struct ConnectionKey
+  {
+    QUuid     outNode;
+    PortIndex outPort = INVALID;
+    QUuid     inNode;
+    PortIndex inPort = INVALID;
+
+    bool
+    isComplete() const { return !outNode.isNull() && !inNode.isNull(); }
+
+    bool
+    operator==(ConnectionKey const& other) const
+    {
+      return outNode == other.outNode && outPort == other.outPort &&
+             inNode == other.inNode && inPort == other.inPort;
+    }
+  };
+
+  struct Record
+  {
+    enum Kind
+    {
+      NodeCreated,
+      NodeRemoved,
+      ConnectionCreated,
+      ConnectionRemoved,
+      NodesMoved,
+      ModelChanged
+    };
+
+    Kind kind;
+
+    /// Node of node and model records
+    QUuid node;
+
+    /// Compact node JSON, or a JSON delta {"set": {}, "removed": []}
+    /// to undo a model change
+    QByteArray data;
+
+    /// Delta to redo a model change
+    QByteArray redoData;
+
+    ConnectionKey connection;
+
+    std::vector<QUuid> nodes;
+    QPointF            offset;
+
+    std::size_t
+    byteSize() const;
+  };
+
+private slots:
+
+  void
+  onNodeCreated(Node& node);
+
+  void
+  onNodesCreated(std::vector<Node*> const& nodes);
+
+  void
+  onNodeDeleted(Node& node);
+
+  void
+  onNodeMoved(Node& node, QPointF const& newLocation);
+
+  void
+  onNodesMoved(std::vector<Node*> const& nodes, QPointF const& offset);
+
+  void
+  onNodesExpanded(std::vector<Node*> const& nodes);
+
+  void
+  onConnectionCreated(Connection& connection);
+
+  void
+  onConnectionsCreated(std::vector<Connection*> const& connections);
+
+  void
+  onConnectionDeleted(Connection& connection);
+
+  void
+  onConnectionUpdated(Connection& connection);
+
+  void
+  onModelUpdated(Node& node);
+
+private:
+
+  friend class SceneJournalCommand;
+
+  /// Caches the node's position and state, watches its model
+  void
+  trackNode(Node& node);
+
+  void
+  trackConnection(Connection& connection);
+
+  void
+  record(Record&& record);
+
+  /// Replays records forwards, or their inverses backwards
+  void
+  apply(std::vector<Record> const& records, bool undo);
+
+  void
+  commandDestroyed(std::size_t bytes) { _journalBytes -= bytes; }
+
+  /// Empties the oldest commands while over maxJournalBytes()
+  void
+  expireOldCommands();
+
+  Node*
+  findNode(QUuid const& id) const;
+
+  Connection*
+  findConnection(ConnectionKey const& key) const;
+
+  void
+  restoreModelDelta(Node& node, QByteArray const& delta);
+
+private:
+
+  FlowScene&  _scene;
+  QUndoStack* _stack;
+
+  std::size_t _maxCommandBytes;
+  std::size_t _maxJournalBytes;
+  std::size_t _journalBytes;
+
+  bool _applying;
+
+  /// Command collecting the records of the current event loop iteration
+  SceneJournalCommand* _current;
+
+  bool _batchPending;
+
+  /// Remaining records of a batch that overflowed are not kept
+  bool _discardBatch;
+
+  /// Last recorded position and model state per node
+  struct NodeSnapshot
+  {
+    QPointF     position;
+    QJsonObject state;
+  };
+
+  std::unordered_map<QUuid, NodeSnapshot> _nodes;
+
+  std::unordered_map<Connection const*, ConnectionKey> _connections;
+};
+}
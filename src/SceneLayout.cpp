@@ -0,0 +1,1080 @@
+#include "SceneLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include "FlowScene.hpp"
+#include "Node.hpp"
+#include "NodeGeometry.hpp"
+#include "NodeState.hpp"
+#include "NodeDataModel.hpp"
+#include "NodeGroupModel.hpp"
+#include "Connection.hpp"
+#include "Trace.hpp"
+
+using QtNodes::SceneLayout;
+using QtNodes::FlowScene;
+using QtNodes::Node;
+using QtNodes::NodeGeometry;
+using QtNodes::NodeGroupModel;
+using QtNodes::Connection;
+using QtNodes::PortType;
+
+namespace
+{
+
+/// Components with at least this many nodes are laid out one after
+/// another with parallel sweeps, smaller ones in parallel as a whole
+std::size_t const parallelSweepThreshold = 256;
+
+/// Connections crossing more columns get no virtual vertices, their
+/// ends are neighbours directly. Keeps the vertex count near linear
+/// when a few connections span most of the graph.
+int const maxVirtualSpan = 8;
+
+/// Side of the grid cells nodes outside a neighbourhood are
+/// bucketed in, about the size of a node
+double const obstacleCellSize = 200.0;
+
+class LayoutJob : public QRunnable
+{
+public:
+
+  LayoutJob(std::function<void()> job)
+    : _job(std::move(job))
+  {}
+
+  void
+  run() override { _job(); }
+
+private:
+
+  std::function<void()> _job;
+};
+
+
+/// Calls `task` for 0 .. count - 1 on the pool, or on the calling
+/// thread without a pool, and returns when all calls are done
+void
+parallelFor(QThreadPool* pool, int count, std::function<void(int)> const& task)
+{
+  int const threads = pool ? std::min(count, pool->maxThreadCount()) : 1;
+
+  if (threads < 2)
+  {
+    for (int i = 0; i < count; ++i)
+      task(i);
+
+    return;
+  }
+
+  for (int t = 0; t < threads; ++t)
+  {
+    pool->start(new LayoutJob([&task, t, threads, count]()
+                              {
+                                for (int i = t; i < count; i += threads)
+                                  task(i);
+                              }));
+  }
+
+  pool->waitForDone();
+}
+
+
+/// Visible nodes and the connections between them
+struct Graph
+{
+  std::vector<Node*> nodes;
+
+  std::vector<QPointF> positions;
+  std::vector<double>  widths;
+  std::vector<double>  heights;
+
+  std::vector<std::vector<int> > successors;
+  std::vector<std::vector<int> > predecessors;
+
+  int
+  size() const { return static_cast<int>(nodes.size()); }
+};
+
+
+Graph
+snapshot(FlowScene const& scene)
+{
+  Graph g;
+
+  std::unordered_map<Node const*, int> index;
+  index.reserve(scene.nodes().size());
+
+  for (auto const &entry : scene.nodes())
+  {
+    Node* node = entry.second.get();
+
+    // represented by their group node
+    if (node->group())
+      continue;
+
+    index.emplace(node, g.size());
+
+    g.nodes.push_back(node);
+    g.positions.push_back(node->position());
+    g.widths.push_back(node->nodeGeometry().width());
+    g.heights.push_back(node->nodeGeometry().height());
+  }
+
+  g.successors.resize(g.nodes.size());
+  g.predecessors.resize(g.nodes.size());
+
+  auto visible =
+    [&index](Node const* node)
+    {
+      if (!node)
+        return -1;
+
+      auto it = index.find(node->group() ? node->group() : node);
+
+      return (it != index.end()) ? it->second : -1;
+    };
+
+  for (auto const &entry : scene.connections())
+  {
+    Connection const &connection = *entry.second;
+
+    int const u = visible(connection.getNode(PortType::Out));
+    int const v = visible(connection.getNode(PortType::In));
+
+    if (u < 0 || v < 0 || u == v)
+      continue;
+
+    g.successors[u].push_back(v);
+    g.predecessors[v].push_back(u);
+  }
+
+  // several connections between two nodes count once
+  for (auto *lists : { &g.successors, &g.predecessors })
+  {
+    for (auto &list : *lists)
+    {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+  }
+
+  return g;
+}
+
+
+/// Node drawn for `node`, its group if it is collapsed
+Node*
+visibleNode(Node* node)
+{
+  return (node && node->group()) ? node->group() : node;
+}
+
+
+/// Connections drawn at `node`: its own and, for a group node, those
+/// crossing the group boundary
+std::vector<Connection*>
+attachedConnections(Node const& node)
+{
+  std::vector<Connection*> result;
+
+  for (PortType portType : { PortType::In, PortType::Out })
+  {
+    for (auto const &connections : node.nodeState().getEntries(portType))
+    {
+      for (auto const &pair : connections)
+        result.push_back(pair.second);
+    }
+  }
+
+  if (auto group = dynamic_cast<NodeGroupModel const*>(node.nodeDataModel()))
+  {
+    std::vector<Connection*> const boundary = group->boundaryConnections();
+
+    result.insert(result.end(), boundary.begin(), boundary.end());
+  }
+
+  return result;
+}
+
+
+/// Grid column or row of a scene coordinate
+int
+obstacleCell(double coordinate)
+{
+  return static_cast<int>(std::floor(coordinate / obstacleCellSize));
+}
+
+
+quint64
+obstacleKey(int column, int row)
+{
+  return (quint64(quint32(column)) << 32) | quint32(row);
+}
+
+
+struct Component
+{
+  std::vector<int> members;
+
+  /// Top left corner of each member relative to the component
+  std::vector<QPointF> positions;
+
+  double width  = 0.0;
+  double height = 0.0;
+};
+
+
+/// Weakly connected components, `local` receives each
+/// node's index inside its component
+std::vector<Component>
+components(Graph const& g, std::vector<int>& local)
+{
+  std::vector<Component> result;
+
+  local.assign(g.nodes.size(), -1);
+
+  std::vector<int> stack;
+
+  for (int root = 0; root < g.size(); ++root)
+  {
+    if (local[root] >= 0)
+      continue;
+
+    Component c;
+
+    local[root] = 0;
+    stack.push_back(root);
+
+    while (!stack.empty())
+    {
+      int const v = stack.back();
+      stack.pop_back();
+
+      c.members.push_back(v);
+
+      for (auto const *list : { &g.successors[v], &g.predecessors[v] })
+      {
+        for (int w : *list)
+        {
+          if (local[w] >= 0)
+            continue;
+
+          local[w] = 0;
+          stack.push_back(w);
+        }
+      }
+    }
+
+    for (std::size_t i = 0; i < c.members.size(); ++i)
+      local[c.members[i]] = static_cast<int>(i);
+
+    result.push_back(std::move(c));
+  }
+
+  return result;
+}
+
+
+/// Tops of the vertices of one column, in order, as close to
+/// `desired` as `spacing` allows. Least squares with the order
+/// kept, solved by pooling adjacent violators.
+void
+placeColumn(std::vector<int> const& column,
+            std::vector<double> const& desired,
+            std::vector<double> const& heights,
+            double spacing,
+            std::vector<double>& tops)
+{
+  struct Block
+  {
+    double sum;
+    int    count;
+    int    first;
+
+    double
+    value() const { return sum / count; }
+  };
+
+  std::vector<Block>  blocks;
+  std::vector<double> offsets(column.size());
+
+  double offset = 0.0;
+
+  for (std::size_t i = 0; i < column.size(); ++i)
+  {
+    int const v = column[i];
+
+    offsets[i] = offset;
+    offset    += heights[v] + spacing;
+
+    blocks.push_back({ desired[v] - offsets[i], 1, static_cast<int>(i) });
+
+    while (blocks.size() > 1 &&
+           blocks[blocks.size() - 2].value() > blocks.back().value())
+    {
+      Block const last = blocks.back();
+      blocks.pop_back();
+
+      blocks.back().sum   += last.sum;
+      blocks.back().count += last.count;
+    }
+  }
+
+  for (Block const &block : blocks)
+  {
+    for (int i = block.first; i < block.first + block.count; ++i)
+      tops[column[i]] = block.value() + offsets[i];
+  }
+}
+
+
+struct Parameters
+{
+  double layerSpacing;
+  double nodeSpacing;
+  int    sweeps;
+};
+
+
+/// Sugiyama layout of one component. With a pool the columns of
+/// one parity are processed in parallel.
+void
+layoutComponent(Graph const& g,
+                std::vector<int> const& local,
+                Parameters const& p,
+                QThreadPool* pool,
+                Component& c)
+{
+  int const n = static_cast<int>(c.members.size());
+
+  // 1. break cycles: edges closing a cycle in a depth-first
+  //    search are reversed
+
+  std::vector<std::pair<int, int> > edges;
+
+  {
+    enum State : char { New, Open, Done };
+
+    std::vector<char> state(n, New);
+
+    std::vector<std::pair<int, std::size_t> > stack;
+
+    for (int root = 0; root < n; ++root)
+    {
+      if (state[root] != New)
+        continue;
+
+      state[root] = Open;
+      stack.emplace_back(root, 0);
+
+      while (!stack.empty())
+      {
+        int const         v    = stack.back().first;
+        std::size_t &     next = stack.back().second;
+        auto const &      succ = g.successors[c.members[v]];
+
+        if (next == succ.size())
+        {
+          state[v] = Done;
+          stack.pop_back();
+          continue;
+        }
+
+        int const w = local[succ[next++]];
+
+        if (state[w] == Open)
+        {
+          edges.emplace_back(w, v);
+        }
+        else
+        {
+          edges.emplace_back(v, w);
+
+          if (state[w] == New)
+          {
+            state[w] = Open;
+            stack.emplace_back(w, 0);
+          }
+        }
+      }
+    }
+  }
+
+  // 2. columns by longest path from the sources; sources
+  //    are moved right next to their first successor
+
+  std::vector<std::vector<int> > dagSucc(n), dagPred(n);
+
+  for (auto const &e : edges)
+  {
+    dagSucc[e.first].push_back(e.second);
+    dagPred[e.second].push_back(e.first);
+  }
+
+  std::vector<int> order;
+  order.reserve(n);
+
+  {
+    std::vector<int> inDegree(n);
+
+    for (int v = 0; v < n; ++v)
+    {
+      inDegree[v] = static_cast<int>(dagPred[v].size());
+
+      if (inDegree[v] == 0)
+        order.push_back(v);
+    }
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+      for (int w : dagSucc[order[i]])
+      {
+        if (--inDegree[w] == 0)
+          order.push_back(w);
+      }
+    }
+  }
+
+  std::vector<int> layer(n, 0);
+
+  for (int v : order)
+  {
+    for (int w : dagSucc[v])
+      layer[w] = std::max(layer[w], layer[v] + 1);
+  }
+
+  for (auto it = order.rbegin(); it != order.rend(); ++it)
+  {
+    int const v = *it;
+
+    if (!dagPred[v].empty() || dagSucc[v].empty())
+      continue;
+
+    int closest = std::numeric_limits<int>::max();
+
+    for (int w : dagSucc[v])
+      closest = std::min(closest, layer[w]);
+
+    layer[v] = closest - 1;
+  }
+
+  // 3. virtual vertices where short connections cross columns
+
+  std::vector<int>    vertexLayer(layer);
+  std::vector<double> heights(n), widths(n);
+
+  for (int v = 0; v < n; ++v)
+  {
+    heights[v] = g.heights[c.members[v]];
+    widths[v]  = g.widths[c.members[v]];
+  }
+
+  std::vector<std::vector<int> > up(n), down(n);
+
+  auto link =
+    [&up, &down](int from, int to)
+    {
+      down[from].push_back(to);
+      up[to].push_back(from);
+    };
+
+  for (auto const &e : edges)
+  {
+    if (layer[e.second] - layer[e.first] > maxVirtualSpan)
+    {
+      link(e.first, e.second);
+      continue;
+    }
+
+    int previous = e.first;
+
+    for (int l = layer[e.first] + 1; l < layer[e.second]; ++l)
+    {
+      int const dummy = static_cast<int>(vertexLayer.size());
+
+      vertexLayer.push_back(l);
+      heights.push_back(0.0);
+      widths.push_back(0.0);
+      up.emplace_back();
+      down.emplace_back();
+
+      link(previous, dummy);
+      previous = dummy;
+    }
+
+    link(previous, e.second);
+  }
+
+  int const nVertices = static_cast<int>(vertexLayer.size());
+  int const nLayers   = 1 + *std::max_element(vertexLayer.begin(), vertexLayer.end());
+
+  // initial order: real vertices in topological order, then the
+  // virtual ones in the order of their connections
+  std::vector<std::vector<int> > columns(nLayers);
+
+  for (int v : order)
+    columns[vertexLayer[v]].push_back(v);
+
+  for (int v = n; v < nVertices; ++v)
+    columns[vertexLayer[v]].push_back(v);
+
+  std::vector<double> rank(nVertices);
+
+  for (auto const &column : columns)
+  {
+    for (std::size_t i = 0; i < column.size(); ++i)
+      rank[column[i]] = static_cast<double>(i);
+  }
+
+  // 4. crossing minimization: barycenter of both neighbouring
+  //    columns, even and odd columns alternately. Direct links can
+  //    join two columns of the same parity, so each half sweep reads
+  //    the ranks of the one before.
+
+  int const parities = std::min(nLayers, 2);
+
+  std::vector<double> before;
+
+  for (int sweep = 0; sweep < p.sweeps; ++sweep)
+  {
+    for (int parity = 0; parity < parities; ++parity)
+    {
+      int const count = (nLayers - parity + 1) / 2;
+
+      before = rank;
+
+      parallelFor(pool, count,
+                  [&](int k)
+                  {
+                    std::vector<int> &column = columns[2 * k + parity];
+
+                    std::vector<std::pair<double, int> > keys;
+                    keys.reserve(column.size());
+
+                    for (int v : column)
+                    {
+                      double sum        = 0.0;
+                      int    neighbours = 0;
+
+                      for (auto const *list : { &up[v], &down[v] })
+                      {
+                        for (int w : *list)
+                        {
+                          sum += before[w];
+                          ++neighbours;
+                        }
+                      }
+
+                      keys.emplace_back(neighbours ? sum / neighbours : before[v], v);
+                    }
+
+                    std::stable_sort(keys.begin(), keys.end(),
+                                     [](std::pair<double, int> const& a,
+                                        std::pair<double, int> const& b)
+                                     { return a.first < b.first; });
+
+                    for (std::size_t i = 0; i < keys.size(); ++i)
+                    {
+                      column[i]            = keys[i].second;
+                      rank[keys[i].second] = static_cast<double>(i);
+                    }
+                  });
+    }
+  }
+
+  // 5. coordinates: columns side by side, each vertex as near
+  //    to the mean height of its neighbours as spacing allows,
+  //    again reading the heights of the half sweep before
+
+  std::vector<double> columnX(nLayers, 0.0);
+
+  {
+    double x = 0.0;
+
+    for (int l = 0; l < nLayers; ++l)
+    {
+      double w = 0.0;
+
+      for (int v : columns[l])
+        w = std::max(w, widths[v]);
+
+      columnX[l] = x;
+      x += w + p.layerSpacing;
+    }
+  }
+
+  std::vector<double> tops(nVertices);
+  std::vector<double> desired(nVertices);
+
+  for (auto const &column : columns)
+  {
+    double y = 0.0;
+
+    for (int v : column)
+    {
+      tops[v] = y;
+      y      += heights[v] + p.nodeSpacing;
+    }
+  }
+
+  for (int sweep = 0; sweep < p.sweeps; ++sweep)
+  {
+    for (int parity = 0; parity < parities; ++parity)
+    {
+      int const count = (nLayers - parity + 1) / 2;
+
+      before = tops;
+
+      parallelFor(pool, count,
+                  [&](int k)
+                  {
+                    std::vector<int> const &column = columns[2 * k + parity];
+
+                    for (int v : column)
+                    {
+                      double sum        = 0.0;
+                      int    neighbours = 0;
+
+                      for (auto const *list : { &up[v], &down[v] })
+                      {
+                        for (int w : *list)
+                        {
+                          sum += before[w] + heights[w] / 2.0;
+                          ++neighbours;
+                        }
+                      }
+
+                      desired[v] = neighbours
+                                   ? sum / neighbours - heights[v] / 2.0
+                                   : before[v];
+                    }
+
+                    placeColumn(column, desired, heights, p.nodeSpacing, tops);
+                  });
+    }
+  }
+
+  // 6. result relative to the top left of the real nodes
+
+  double top = std::numeric_limits<double>::max();
+
+  for (int v = 0; v < n; ++v)
+    top = std::min(top, tops[v]);
+
+  c.positions.resize(n);
+
+  for (int v = 0; v < n; ++v)
+  {
+    c.positions[v] = QPointF(columnX[vertexLayer[v]], tops[v] - top);
+
+    c.width  = std::max(c.width,  c.positions[v].x() + widths[v]);
+    c.height = std::max(c.height, c.positions[v].y() + heights[v]);
+  }
+}
+}
+
+SceneLayout::
+SceneLayout()
+  : _layerSpacing(80.0)
+  , _nodeSpacing(30.0)
+  , _sweeps(8)
+  , _threadCount(std::max(1, QThread::idealThreadCount()))
+{}
+
+
+void
+SceneLayout::
+setThreadCount(int count)
+{
+  _threadCount = std::max(1, count);
+}
+
+
+std::vector<std::pair<Node*, QPointF> >
+SceneLayout::
+computeLayout(FlowScene const& scene) const
+{
+  NODE_EDITOR_TRACE_SCOPE("layout", "SceneLayout::computeLayout");
+
+  Graph const g = snapshot(scene);
+
+  std::vector<std::pair<Node*, QPointF> > result;
+
+  if (g.nodes.empty())
+    return result;
+
+  std::vector<int> local;
+
+  std::vector<Component> parts = components(g, local);
+
+  std::sort(parts.begin(), parts.end(),
+            [](Component const& a, Component const& b)
+            { return a.members.size() > b.members.size(); });
+
+  Parameters const p{ _layerSpacing, _nodeSpacing, std::max(0, _sweeps) };
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(_threadCount);
+
+  // large components share the pool between their columns,
+  // the remaining ones get a thread each
+  std::size_t large = 0;
+
+  while (large < parts.size() &&
+         parts[large].members.size() >= parallelSweepThreshold)
+  {
+    layoutComponent(g, local, p, &pool, parts[large]);
+    ++large;
+  }
+
+  parallelFor(&pool, static_cast<int>(parts.size() - large),
+              [&](int i)
+              {
+                layoutComponent(g, local, p, nullptr, parts[large + i]);
+              });
+
+  // components are stacked in columns about as high as the
+  // largest component, or as the whole area if that is higher
+
+  QPointF origin = g.positions.front();
+
+  double area = 0.0;
+
+  for (int v = 0; v < g.size(); ++v)
+  {
+    origin.setX(std::min(origin.x(), g.positions[v].x()));
+    origin.setY(std::min(origin.y(), g.positions[v].y()));
+  }
+
+  for (Component const &c : parts)
+    area += (c.width + _layerSpacing) * (c.height + _layerSpacing);
+
+  double const maxHeight = std::max(parts.front().height, std::sqrt(area));
+
+  result.reserve(g.nodes.size());
+
+  double x = 0.0, y = 0.0, columnWidth = 0.0;
+
+  for (Component const &c : parts)
+  {
+    if (y > 0.0 && y + c.height > maxHeight)
+    {
+      x += columnWidth + _layerSpacing;
+      y  = 0.0;
+
+      columnWidth = 0.0;
+    }
+
+    for (std::size_t i = 0; i < c.members.size(); ++i)
+      result.emplace_back(g.nodes[c.members[i]],
+                          origin + QPointF(x, y) + c.positions[i]);
+
+    y += c.height + _layerSpacing;
+
+    columnWidth = std::max(columnWidth, c.width);
+  }
+
+  return result;
+}
+
+
+std::vector<std::pair<Node*, QPointF> >
+SceneLayout::
+computeNeighbourhoodLayout(FlowScene const& scene,
+                           std::vector<Node*> const& nodes,
+                           int radius) const
+{
+  NODE_EDITOR_TRACE_SCOPE("layout", "SceneLayout::computeNeighbourhoodLayout");
+
+  std::vector<std::pair<Node*, QPointF> > result;
+
+  // the region and the nodes one connection beyond it, whose
+  // positions the region is placed against
+
+  Graph g;
+
+  std::unordered_map<Node const*, int> index;
+
+  std::vector<int> distance;
+  std::vector<int> region;
+
+  auto add =
+    [&](Node* node)
+    {
+      auto const inserted = index.emplace(node, g.size());
+
+      if (inserted.second)
+      {
+        g.nodes.push_back(node);
+        g.positions.push_back(node->position());
+        g.widths.push_back(node->nodeGeometry().width());
+        g.heights.push_back(node->nodeGeometry().height());
+        g.successors.emplace_back();
+        g.predecessors.emplace_back();
+
+        distance.push_back(-1);
+      }
+
+      return inserted.first->second;
+    };
+
+  for (Node* node : nodes)
+  {
+    int const v = add(visibleNode(node));
+
+    if (distance[v] == 0)
+      continue;
+
+    distance[v] = 0;
+    region.push_back(v);
+  }
+
+  // nodes within `radius` connections, breadth first
+
+  for (std::size_t i = 0; i < region.size(); ++i)
+  {
+    int const v    = region[i];
+    Node* const node = g.nodes[v];
+
+    for (Connection* connection : attachedConnections(*node))
+    {
+      Node* const out = visibleNode(connection->getNode(PortType::Out));
+      Node* const in  = visibleNode(connection->getNode(PortType::In));
+
+      if (!out || !in || out == in)
+        continue;
+
+      int const w = add(out == node ? in : out);
+
+      if (out == node)
+      {
+        g.successors[v].push_back(w);
+        g.predecessors[w].push_back(v);
+      }
+      else
+      {
+        g.predecessors[v].push_back(w);
+        g.successors[w].push_back(v);
+      }
+
+      if (distance[w] < 0 && distance[v] < radius)
+      {
+        distance[w] = distance[v] + 1;
+        region.push_back(w);
+      }
+    }
+  }
+
+  // several connections between two nodes count once
+  for (auto *lists : { &g.successors, &g.predecessors })
+  {
+    for (auto &list : *lists)
+    {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+  }
+
+  if (region.empty())
+    return result;
+
+  // inputs before outputs inside the region; nodes on cycles
+  // follow in breadth first order
+
+  std::vector<int> order;
+  order.reserve(region.size());
+
+  {
+    std::unordered_map<int, int> inDegree;
+
+    for (int v : region)
+    {
+      int &degree = inDegree[v];
+
+      for (int u : g.predecessors[v])
+        degree += (distance[u] >= 0) ? 1 : 0;
+
+      if (degree == 0)
+        order.push_back(v);
+    }
+
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+      for (int w : g.successors[order[i]])
+      {
+        if (distance[w] >= 0 && --inDegree[w] == 0)
+          order.push_back(w);
+      }
+    }
+
+    std::unordered_set<int> const placed(order.begin(), order.end());
+
+    for (int v : region)
+    {
+      if (!placed.count(v))
+        order.push_back(v);
+    }
+  }
+
+  std::vector<QPointF> positions = g.positions;
+
+  auto rect =
+    [&](int v)
+    {
+      return QRectF(positions[v], QSizeF(g.widths[v], g.heights[v]));
+    };
+
+  std::vector<char> moved(g.nodes.size(), 0);
+
+  // every other visible node is an obstacle at its current position;
+  // one pass buckets them so that a push only tests nearby nodes
+
+  std::unordered_map<quint64, std::vector<QRectF> > obstacles;
+
+  for (auto const &entry : scene.nodes())
+  {
+    Node const* node = entry.second.get();
+
+    if (node->group())
+      continue;
+
+    auto it = index.find(node);
+
+    if (it != index.end() && distance[it->second] >= 0)
+      continue;
+
+    NodeGeometry const &geom = node->nodeGeometry();
+
+    QRectF const r(node->position(), QSizeF(geom.width(), geom.height()));
+
+    for (int x = obstacleCell(r.left()); x <= obstacleCell(r.right()); ++x)
+    {
+      for (int y = obstacleCell(r.top()); y <= obstacleCell(r.bottom()); ++y)
+        obstacles[obstacleKey(x, y)].push_back(r);
+    }
+  }
+
+  for (int v : order)
+  {
+    QPointF pos = positions[v];
+
+    if (!g.predecessors[v].empty())
+    {
+      double right = std::numeric_limits<double>::lowest();
+
+      for (int u : g.predecessors[v])
+        right = std::max(right, positions[u].x() + g.widths[u]);
+
+      pos.setX(right + _layerSpacing);
+    }
+    else if (!g.successors[v].empty())
+    {
+      double left = std::numeric_limits<double>::max();
+
+      for (int w : g.successors[v])
+        left = std::min(left, positions[w].x());
+
+      pos.setX(left - _layerSpacing - g.widths[v]);
+    }
+
+    double sum   = 0.0;
+    int    count = 0;
+
+    for (auto const *list : { &g.successors[v], &g.predecessors[v] })
+    {
+      for (int w : *list)
+      {
+        sum += positions[w].y() + g.heights[w] / 2.0;
+        ++count;
+      }
+    }
+
+    if (count)
+      pos.setY(sum / count - g.heights[v] / 2.0);
+
+    positions[v] = pos;
+
+    // push down below every node in the way: the obstacles in the
+    // cells under the node and the region nodes placed before it
+    bool overlaps = true;
+
+    while (overlaps)
+    {
+      overlaps = false;
+
+      QRectF const r = rect(v).adjusted(0.0, -_nodeSpacing, 0.0, _nodeSpacing);
+
+      auto pushBelow =
+        [&](QRectF const& other)
+        {
+          if (!r.intersects(other))
+            return;
+
+          positions[v].setY(std::max(positions[v].y(),
+                                     other.bottom() + _nodeSpacing));
+          overlaps = true;
+        };
+
+      for (int x = obstacleCell(r.left()); x <= obstacleCell(r.right()); ++x)
+      {
+        for (int y = obstacleCell(r.top()); y <= obstacleCell(r.bottom()); ++y)
+        {
+          auto const cell = obstacles.find(obstacleKey(x, y));
+
+          if (cell == obstacles.end())
+            continue;
+
+          for (QRectF const &other : cell->second)
+            pushBelow(other);
+        }
+      }
+
+      for (int w : region)
+      {
+        if (w != v && moved[w])
+          pushBelow(rect(w));
+      }
+    }
+
+    moved[v] = 1;
+  }
+
+  result.reserve(region.size());
+
+  for (int v : region)
+  {
+    if (positions[v] != g.positions[v])
+      result.emplace_back(g.nodes[v], positions[v]);
+  }
+
+  return result;
+}
+
+
+void
+SceneLayout::
+layout(FlowScene& scene) const
+{
+  scene.setNodePositions(computeLayout(scene));
+}
+
+
+void
+SceneLayout::
+layoutNeighbourhood(FlowScene& scene,
+                    std::vector<Node*> const& nodes,
+                    int radius) const
+{
+  scene.setNodePositions(computeNeighbourhoodLayout(scene, nodes, radius));
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <QtCore/QPointF>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+class FlowScene;
+class Node;
+
+/// Layered (Sugiyama style) arrangement of the nodes of a FlowScene.
+///
+/// Connections point from left to right: cycles are broken, nodes are
+/// assigned to columns by longest path, long connections get virtual
+/// nodes in the columns they cross, and the order inside the columns
+/// is improved by barycenter sweeps. Vertical positions are placed as
+/// close to the connected nodes as the spacing allows.
+///
+/// The topology is read on the calling thread. Sweeps update all even
+/// and then all odd columns in parallel; each half sweep reads the
+/// ranks and heights left by the one before, so columns of one parity
+/// do not depend on each other even when a long connection joins them
+/// directly. Small connected components are laid out in parallel as a
+/// whole. The result is applied with a single
+/// FlowScene::setNodePositions(). Collapsed nodes are represented by
+/// their group node.
+class NODE_EDITOR_PUBLIC SceneLayout
+{
+public:
+
+  SceneLayout();
+
+public:
+
+  /// Horizontal gap between columns
+  double
+  layerSpacing() const { return _layerSpacing; }
+
+  void
+  setLayerSpacing(double spacing) { _layerSpacing = spacing; }
+
+  /// Vertical gap between nodes of a column
+  double
+  nodeSpacing() const { return _nodeSpacing; }
+
+  void
+  setNodeSpacing(double spacing) { _nodeSpacing = spacing; }
+
+  /// Iterations of crossing minimization and of vertical placement
+  int
+  sweeps() const { return _sweeps; }
+
+  void
+  setSweeps(int sweeps) { _sweeps = sweeps; }
+
+  /// Number of worker threads, defaults to QThread::idealThreadCount()
+  int
+  threadCount() const { return _threadCount; }
+
+  void
+  setThreadCount(int count);
+
+public:
+
+  /// Positions for all visible nodes. Connected components are
+  /// stacked, the largest first, at the top left of the current
+  /// bounds of the nodes.
+  std::vector<std::pair<Node*, QPointF> >
+  computeLayout(FlowScene const& scene) const;
+
+  /// Positions for the nodes within `radius` connections of `nodes`.
+  /// Each of them is placed right of its inputs and left of its
+  /// outputs, at the mean height of its neighbours, and pushed down
+  /// until it overlaps no other node. All other nodes stay.
+  std::vector<std::pair<Node*, QPointF> >
+  computeNeighbourhoodLayout(FlowScene const& scene,
+                             std::vector<Node*> const& nodes,
+                             int radius = 1) const;
+
+  /// Applies computeLayout()
+  void
+  layout(FlowScene& scene) const;
+
+  /// Applies computeNeighbourhoodLayout(), e.g. after nodes were
+  /// created or connected
+  void
+  layoutNeighbourhood(FlowScene& scene,
+                      std::vector<Node*> const& nodes,
+                      int radius = 1) const;
+
+private:
+
+  double _layerSpacing;
+  double _nodeSpacing;
+
+  int _sweeps;
+  int _threadCount;
+};
+}
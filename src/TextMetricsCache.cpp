@@ -0,0 +1,161 @@
+#include "TextMetricsCache.hpp"
+
+#include <algorithm>
+
+#include <QtGui/QTransform>
+
+using QtNodes::TextMetrics;
+using QtNodes::TextMetricsCache;
+
+namespace
+{
+
+struct CacheState
+{
+  QHash<QString, std::shared_ptr<TextMetrics>> metrics;
+
+  int maxEntries = 4096;
+
+  quint64 hits   = 0;
+  quint64 misses = 0;
+};
+
+
+CacheState &
+cacheState()
+{
+  static CacheState state;
+
+  return state;
+}
+
+
+template<typename T, typename Measure>
+T
+lookup(QHash<QString, T> &cache, QString const &text, Measure measure)
+{
+  auto it = cache.constFind(text);
+
+  if (it != cache.constEnd())
+  {
+    ++cacheState().hits;
+    return it.value();
+  }
+
+  ++cacheState().misses;
+
+  if (cache.size() >= cacheState().maxEntries)
+    cache.clear();
+
+  T const value = measure(text);
+
+  cache.insert(text, value);
+
+  return value;
+}
+}
+
+TextMetrics::
+TextMetrics(QFont const &font)
+  : _font(font)
+  , _fontMetrics(font)
+{}
+
+
+QRect
+TextMetrics::
+boundingRect(QString const &text) const
+{
+  return lookup(_boundingRects, text,
+                [this](QString const &s) { return _fontMetrics.boundingRect(s); });
+}
+
+
+int
+TextMetrics::
+width(QString const &text) const
+{
+  return lookup(_widths, text,
+                [this](QString const &s) { return _fontMetrics.width(s); });
+}
+
+
+QStaticText
+TextMetrics::
+staticText(QString const &text) const
+{
+  return lookup(_staticTexts, text,
+                [this](QString const &s)
+    {
+      QStaticText result(s);
+
+      result.setTextFormat(Qt::PlainText);
+
+      // views share the strings at different scales, QPainter
+      // re-prepares for its transform where it differs
+      result.prepare(QTransform(), _font);
+
+      return result;
+    });
+}
+
+
+std::shared_ptr<TextMetrics>
+TextMetricsCache::
+forFont(QFont const &font)
+{
+  auto &state = cacheState();
+
+  QString const key = font.key();
+
+  auto it = state.metrics.constFind(key);
+
+  if (it != state.metrics.constEnd())
+    return it.value();
+
+  auto metrics = std::make_shared<TextMetrics>(font);
+
+  state.metrics.insert(key, metrics);
+
+  return metrics;
+}
+
+
+int
+TextMetricsCache::
+maxEntries()
+{
+  return cacheState().maxEntries;
+}
+
+
+void
+TextMetricsCache::
+setMaxEntries(int maxEntries)
+{
+  cacheState().maxEntries = std::max(1, maxEntries);
+}
+
+
+void
+TextMetricsCache::
+clear()
+{
+  cacheState().metrics.clear();
+}
+
+
+quint64
+TextMetricsCache::
+hits()
+{
+  return cacheState().hits;
+}
+
+
+quint64
+TextMetricsCache::
+misses()
+{
+  return cacheState().misses;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <memory>
+
+#include <QtCore/QHash>
+#include <QtCore/QRect>
+#include <QtCore/QString>
+#include <QtGui/QFont>
+#include <QtGui/QFontMetrics>
+#include <QtGui/QStaticText>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Font metrics plus a bounded cache of measured and laid out strings.
+/// One instance is shared by every NodeGeometry using the same font,
+/// so identical captions and labels are measured and shaped once.
+/// Like QFontMetrics it must only be used from the GUI thread.
+class NODE_EDITOR_PUBLIC TextMetrics
+{
+public:
+
+  TextMetrics(QFont const &font);
+
+public:
+
+  QFont const &
+  font() const { return _font; }
+
+  QFontMetrics const &
+  fontMetrics() const { return _fontMetrics; }
+
+  int
+  height() const { return _fontMetrics.height(); }
+
+  QRect
+  boundingRect(QString const &text) const;
+
+  int
+  width(QString const &text) const;
+
+  /// Plain text laid out in this font, ready for QPainter::drawStaticText.
+  /// QStaticText is implicitly shared, nodes keep cheap copies.
+  ///
+  /// The layout is prepared for an unscaled painter, so drawing reuses
+  /// it only at 100% zoom. At any other scale QPainter lays the text out
+  /// again on the first draw and keeps that layout in the shared data
+  /// until the scale changes; beyond 100% zoom the cache saves the
+  /// measuring, not the per-zoom layout.
+  QStaticText
+  staticText(QString const &text) const;
+
+private:
+
+  QFont _font;
+
+  QFontMetrics _fontMetrics;
+
+  mutable QHash<QString, QRect> _boundingRects;
+  mutable QHash<QString, int>   _widths;
+
+  mutable QHash<QString, QStaticText> _staticTexts;
+};
+
+/// Process-wide registry of TextMetrics, one per distinct font.
+class NODE_EDITOR_PUBLIC TextMetricsCache
+{
+public:
+
+  static
+  std::shared_ptr<TextMetrics>
+  forFont(QFont const &font);
+
+  /// Upper bound of cached strings per font and measurement kind.
+  /// A full cache is dropped and refilled on demand.
+  static
+  int
+  maxEntries();
+
+  static
+  void
+  setMaxEntries(int maxEntries);
+
+  /// Drops all cached metrics and measurements
+  static
+  void
+  clear();
+
+  static
+  quint64
+  hits();
+
+  static
+  quint64
+  misses();
+
+private:
+
+  TextMetricsCache() = delete;
+};
+}
@@ -0,0 +1,280 @@
+#include "Trace.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QTextStream>
+
+using QtNodes::Trace;
+
+namespace
+{
+
+/// One ring buffer slot. `sequence` is odd while the owning thread
+/// writes the slot; readers skip slots that change while being read.
+struct TraceEvent
+{
+  std::atomic<quint32> sequence{ 0 };
+
+  char const* category = nullptr;
+  char const* name     = nullptr;
+
+  qint64 start    = 0;
+  qint64 duration = 0;
+
+  char phase = 'X';
+};
+
+
+struct ThreadBuffer
+{
+  ThreadBuffer(int threadId)
+    : threadId(threadId)
+    , events(new TraceEvent[Trace::bufferCapacity])
+  {}
+
+  int const threadId;
+
+  /// Number of events ever written
+  std::atomic<quint64> head{ 0 };
+
+  /// Events before this index were dropped by Trace::clear()
+  std::atomic<quint64> begin{ 0 };
+
+  std::unique_ptr<TraceEvent[]> events;
+};
+
+
+struct Registry
+{
+  QMutex mutex;
+
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers;
+};
+
+
+Registry &
+registry()
+{
+  static Registry instance;
+
+  return instance;
+}
+
+
+/// Buffers outlive their threads so the events stay exportable
+ThreadBuffer &
+threadBuffer()
+{
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+
+  if (!buffer)
+  {
+    Registry &r = registry();
+
+    QMutexLocker locker(&r.mutex);
+
+    buffer = std::make_shared<ThreadBuffer>(int(r.buffers.size()) + 1);
+
+    r.buffers.push_back(buffer);
+  }
+
+  return *buffer;
+}
+
+
+void
+record(char phase,
+       char const* category,
+       char const* name,
+       qint64 start,
+       qint64 duration)
+{
+  ThreadBuffer &buffer = threadBuffer();
+
+  quint64 const index = buffer.head.load(std::memory_order_relaxed);
+
+  TraceEvent &event = buffer.events[index % Trace::bufferCapacity];
+
+  quint32 const sequence = event.sequence.load(std::memory_order_relaxed);
+
+  event.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  event.category = category;
+  event.name     = name;
+  event.start    = start;
+  event.duration = duration;
+  event.phase    = phase;
+
+  event.sequence.store(sequence + 2, std::memory_order_release);
+
+  buffer.head.store(index + 1, std::memory_order_release);
+}
+
+
+QString
+escaped(char const* text)
+{
+  QString result = QString::fromLatin1(text ? text : "");
+
+  result.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+  result.replace(QLatin1Char('"'),  QLatin1String("\\\""));
+
+  return result;
+}
+}
+
+constexpr std::size_t Trace::bufferCapacity;
+
+std::atomic<bool> Trace::_enabled{ false };
+
+
+void
+Trace::
+setEnabled(bool enabled)
+{
+  _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+qint64
+Trace::
+now()
+{
+  using Clock = std::chrono::steady_clock;
+
+  static Clock::time_point const origin = Clock::now();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+}
+
+
+void
+Trace::
+complete(char const* category,
+         char const* name,
+         qint64 startNs,
+         qint64 durationNs)
+{
+  if (isEnabled())
+    record('X', category, name, startNs, durationNs);
+}
+
+
+void
+Trace::
+instant(char const* category, char const* name)
+{
+  if (isEnabled())
+    record('i', category, name, now(), 0);
+}
+
+
+void
+Trace::
+clear()
+{
+  Registry &r = registry();
+
+  QMutexLocker locker(&r.mutex);
+
+  for (auto const &buffer : r.buffers)
+    buffer->begin.store(buffer->head.load(std::memory_order_acquire));
+}
+
+
+bool
+Trace::
+exportChromeTrace(QString const& fileName,
+                  qint64 fromNs,
+                  qint64 toNs)
+{
+  QFile file(fileName);
+
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    return false;
+
+  QTextStream out(&file);
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+  bool first = true;
+
+  auto separator =
+    [&]()
+    {
+      if (!first)
+        out << ",\n";
+
+      first = false;
+    };
+
+  Registry &r = registry();
+
+  QMutexLocker locker(&r.mutex);
+
+  for (auto const &buffer : r.buffers)
+  {
+    separator();
+
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+        << buffer->threadId
+        << ",\"args\":{\"name\":\"thread " << buffer->threadId << "\"}}";
+
+    quint64 const head  = buffer->head.load(std::memory_order_acquire);
+    quint64 const begin = std::max(buffer->begin.load(),
+                                   head > bufferCapacity ? head - bufferCapacity : 0);
+
+    for (quint64 i = begin; i < head; ++i)
+    {
+      TraceEvent const &slot = buffer->events[i % bufferCapacity];
+
+      quint32 const sequence = slot.sequence.load(std::memory_order_acquire);
+
+      if (sequence & 1)
+        continue;
+
+      TraceEvent event;
+      event.category = slot.category;
+      event.name     = slot.name;
+      event.start    = slot.start;
+      event.duration = slot.duration;
+      event.phase    = slot.phase;
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      // overwritten by the recording thread while we were reading
+      if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+        continue;
+
+      if (event.start > toNs || event.start + event.duration < fromNs)
+        continue;
+
+      separator();
+
+      out << "{\"name\":\"" << escaped(event.name)
+          << "\",\"cat\":\"" << escaped(event.category)
+          << "\",\"ph\":\"" << event.phase
+          << "\",\"ts\":" << QString::number(event.start / 1000.0, 'f', 3);
+
+      if (event.phase == 'X')
+        out << ",\"dur\":" << QString::number(event.duration / 1000.0, 'f', 3);
+      else
+        out << ",\"s\":\"t\"";
+
+      out << ",\"pid\":1,\"tid\":" << buffer->threadId << "}";
+    }
+  }
+
+  out << "\n]}\n";
+
+  out.flush();
+
+  return file.error() == QFile::NoError;
+}
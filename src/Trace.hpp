@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <limits>
+
+#include <QtCore/QtGlobal>
+#include <QtCore/QString>
+
+#include "Export.hpp"
+
+namespace QtNodes
+{
+
+/// Event timeline recorder with Chrome trace (chrome://tracing,
+/// Perfetto) export.
+///
+/// Every thread records into its own fixed size ring buffer, recording
+/// takes no locks; old events are overwritten once a buffer is full.
+/// Names and categories must be string literals, only the pointers are
+/// stored. Use the NODE_EDITOR_TRACE_* macros, they compile to nothing
+/// unless NODE_EDITOR_TRACING is defined.
+class NODE_EDITOR_PUBLIC Trace
+{
+public:
+
+  /// Events kept per thread
+  static constexpr std::size_t bufferCapacity = 1 << 16;
+
+  static
+  bool
+  isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+  static
+  void
+  setEnabled(bool enabled);
+
+  /// Monotonic timestamp in nanoseconds used for all events
+  static
+  qint64
+  now();
+
+  /// Records an event that started at `startNs` and lasted `durationNs`
+  static
+  void
+  complete(char const* category,
+           char const* name,
+           qint64 startNs,
+           qint64 durationNs);
+
+  static
+  void
+  instant(char const* category, char const* name);
+
+  /// Drops all recorded events
+  static
+  void
+  clear();
+
+  /// Writes the events overlapping [fromNs, toNs] as Chrome trace JSON
+  static
+  bool
+  exportChromeTrace(QString const& fileName,
+                    qint64 fromNs = 0,
+                    qint64 toNs = std::numeric_limits<qint64>::max());
+
+private:
+
+  static std::atomic<bool> _enabled;
+};
+
+
+/// Records a complete event for the lifetime of the object
+class TraceScope
+{
+public:
+
+  TraceScope(char const* category, char const* name)
+    : _category(category)
+    , _name(name)
+    , _start(Trace::isEnabled() ? Trace::now() : -1)
+  {}
+
+  ~TraceScope()
+  {
+    if (_start >= 0)
+      Trace::complete(_category, _name, _start, Trace::now() - _start);
+  }
+
+  TraceScope(TraceScope const&) = delete;
+  TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+
+  char const* _category;
+  char const* _name;
+
+  qint64 _start;
+};
+}
+
+#define NODE_EDITOR_TRACE_CONCAT_IMPL(a, b) a ## b
+#define NODE_EDITOR_TRACE_CONCAT(a, b) NODE_EDITOR_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef NODE_EDITOR_TRACING
+
+#define NODE_EDITOR_TRACE_SCOPE(category, name)              \
+  QtNodes::TraceScope                                       \
+  NODE_EDITOR_TRACE_CONCAT(_nodeEditorTrace, __LINE__)(category, name)
+
+#define NODE_EDITOR_TRACE_INSTANT(category, name) \
+  QtNodes::Trace::instant(category, name)
+
+#else
+
+#define NODE_EDITOR_TRACE_SCOPE(category, name)   do {} while (false)
+#define NODE_EDITOR_TRACE_INSTANT(category, name) do {} while (false)
+
+#endif